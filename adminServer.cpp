@@ -0,0 +1,99 @@
+#include "adminServer.hpp"
+#include <memory>
+#include <sstream>
+
+// ============================================================================
+// ADMIN SERVER - Request handling
+// ============================================================================
+
+using boost::asio::ip::tcp;
+
+AdminServer::AdminServer(boost::asio::io_context& io, unsigned short port)
+    : acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), port)) {}
+
+void AdminServer::route(const std::string& path, Handler handler) {
+    routes[path] = std::move(handler);
+}
+
+void AdminServer::start() {
+    acceptOne();
+}
+
+void AdminServer::stop() {
+    boost::system::error_code ignored;
+    acceptor.close(ignored);
+}
+
+void AdminServer::acceptOne() {
+    acceptor.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (ec == boost::asio::error::operation_aborted) {
+            return;
+        }
+        if (!ec) {
+            serve(std::make_shared<tcp::socket>(std::move(socket)));
+        }
+        acceptOne();
+    });
+}
+
+void AdminServer::serve(std::shared_ptr<tcp::socket> socket) {
+    /*
+     * Read up to the end of the request head (a scraper sends no body),
+     * answer, close. The buffer is capped so a client that never sends
+     * "\r\n\r\n" can't grow it forever.
+     */
+    auto request = std::make_shared<boost::asio::streambuf>(8192);
+    boost::asio::async_read_until(*socket, *request, "\r\n\r\n",
+        [this, socket, request](boost::system::error_code ec, std::size_t headLength) {
+            if (ec) {
+                return;
+            }
+            std::string head(boost::asio::buffers_begin(request->data()),
+                             boost::asio::buffers_begin(request->data()) + headLength);
+            auto response = std::make_shared<std::string>(respond(head));
+            boost::asio::async_write(*socket, boost::asio::buffer(*response),
+                [socket, response](boost::system::error_code, std::size_t) {
+                    boost::system::error_code ignored;
+                    socket->shutdown(tcp::socket::shutdown_both, ignored);
+                });
+        });
+}
+
+std::string AdminServer::respond(const std::string& requestHead) const {
+    std::istringstream line(requestHead.substr(0, requestHead.find("\r\n")));
+    std::string method, target;
+    line >> method >> target;
+
+    size_t question = target.find('?');
+    std::string path = target.substr(0, question);
+    Query query;
+    if (question != std::string::npos) {
+        std::istringstream pairs(target.substr(question + 1));
+        std::string pair;
+        while (std::getline(pairs, pair, '&')) {
+            size_t equals = pair.find('=');
+            query[pair.substr(0, equals)] = equals == std::string::npos ? "" : pair.substr(equals + 1);
+        }
+    }
+
+    std::string status = "200 OK";
+    Response response{"text/plain; charset=utf-8", ""};
+    auto found = routes.find(path);
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+        response.body = "GET only\n";
+    } else if (found == routes.end()) {
+        status = "404 Not Found";
+        response.body = "not found\n";
+    } else {
+        response = found->second(query);
+    }
+
+    std::ostringstream out;
+    out << "HTTP/1.0 " << status << "\r\n"
+        << "Content-Type: " << response.contentType << "\r\n"
+        << "Content-Length: " << response.body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << response.body;
+    return out.str();
+}
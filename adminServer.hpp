@@ -0,0 +1,55 @@
+#include <utility>  // must precede asio: boost 1.74 awaitable.hpp uses std::exchange
+#include <boost/asio.hpp>
+#include <functional>
+#include <map>
+#include <string>
+
+#ifndef ADMIN_SERVER_HPP
+#define ADMIN_SERVER_HPP
+
+/*
+ * ============================================================================
+ * ADMIN SERVER - A tiny HTTP endpoint for operators
+ * ============================================================================
+ *
+ * Bound to 127.0.0.1 only, on its own port (--admin-port), running on the
+ * accept io_context - never on a worker. One request per connection,
+ * HTTP/1.0 style: read the request head, answer, close. That's all a
+ * Prometheus scraper or curl needs, and it keeps this file short.
+ *
+ * Handlers are registered by path and return the response body; they run
+ * on the admin thread, so they must only read lock-free state (metrics
+ * shards, atomics) - never take a lock an io thread might be holding
+ * across a fan-out. Locks only taken when sessions come and go (the memory
+ * ledger's) are fine. The query string arrives parsed: "?n=5&x" becomes
+ * {"n": "5", "x": ""}; there's no %-decoding.
+ * ============================================================================
+ */
+
+class AdminServer {
+public:
+    struct Response {
+        std::string contentType;
+        std::string body;
+    };
+    using Query = std::map<std::string, std::string>;
+    using Handler = std::function<Response(const Query&)>;
+
+    AdminServer(boost::asio::io_context& io, unsigned short port);
+
+    void route(const std::string& path, Handler handler);
+    void start();
+    void stop();
+
+    unsigned short port() const { return acceptor.local_endpoint().port(); }
+
+private:
+    void acceptOne();
+    void serve(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+    std::string respond(const std::string& requestHead) const;
+
+    boost::asio::ip::tcp::acceptor acceptor;
+    std::map<std::string, Handler> routes;
+};
+
+#endif // ADMIN_SERVER_HPP
@@ -0,0 +1,142 @@
+#include "../listener.hpp"
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+/*
+ * ============================================================================
+ * ACCEPT BENCHMARK - How fast can the Listener onboard a reconnect storm?
+ * ============================================================================
+ *
+ * Runs the real Room + Listener + IoPool in-process on an ephemeral loopback
+ * port, then fires N connects at it from a separate io thread with a fixed
+ * window of connects in flight. The clock stops when the Listener has handed
+ * all N sockets to Sessions - that's "accepted", not just "SYN-ACKed by the
+ * kernel".
+ *
+ * Sweeps pendingAccepts and acceptBatch so the effect of each knob is
+ * visible on its own.
+ *
+ *   ./bench/acceptBench [connections] [io-threads]
+ * ============================================================================
+ */
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double seconds;
+    uint64_t accepted;
+};
+
+static Result runOnce(size_t connections, size_t ioThreads, size_t pendingAccepts, size_t acceptBatch) {
+    ServerConfig config;
+    config.ioThreads = ioThreads;
+    config.pendingAccepts = pendingAccepts;
+    config.acceptBatch = acceptBatch;
+
+    IoPool workers(config.ioThreads);
+    Room room;
+    boost::asio::io_context acceptIo(1);
+    Listener listener(acceptIo, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0),
+                      room, workers, config);
+    Listener::Endpoint bound = listener.localEndpoint();
+    tcp::endpoint target;
+    std::memcpy(target.data(), bound.data(), bound.size());
+
+    workers.start();
+    listener.start();
+    std::thread acceptThread([&]() { acceptIo.run(); });
+
+    // Client side: keep `window` connects in flight until N have been issued.
+    boost::asio::io_context clientIo(1);
+    std::vector<std::unique_ptr<tcp::socket>> clients;
+    clients.reserve(connections);
+    const size_t window = 512;
+    size_t issued = 0;
+
+    std::function<void()> connectNext = [&]() {
+        if (issued >= connections) {
+            return;
+        }
+        ++issued;
+        clients.push_back(std::make_unique<tcp::socket>(clientIo));
+        tcp::socket& socket = *clients.back();
+        socket.async_connect(target, [&](boost::system::error_code ec) {
+            if (ec) {
+                std::cerr << "connect failed: " << ec.message() << "\n";
+            }
+            connectNext();
+        });
+    };
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < window; ++i) {
+        connectNext();
+    }
+    clientIo.run();
+
+    auto deadline = Clock::now() + std::chrono::seconds(30);
+    while (listener.acceptedCount() < connections && Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t accepted = listener.acceptedCount();
+
+    // RST instead of FIN so repeated runs don't pile up TIME_WAIT sockets.
+    for (auto& socket : clients) {
+        boost::system::error_code ignored;
+        socket->set_option(boost::asio::socket_base::linger(true, 0), ignored);
+        socket->close(ignored);
+    }
+
+    listener.stop();
+    acceptIo.stop();
+    acceptThread.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));  // let Sessions see the resets
+    workers.stop();
+    workers.join();
+    return {seconds, accepted};
+}
+
+int main(int argc, char* argv[]) {
+    size_t connections = argc > 1 ? parsePositive("connections", argv[1]) : 10000;
+    size_t ioThreads = argc > 2 ? parsePositive("io-threads", argv[2]) : 4;
+
+    // Each connection is two fds in this process (client + server end).
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < 2 * connections + 64) {
+        std::cerr << "warning: RLIMIT_NOFILE " << limit.rlim_cur << " is too low for "
+                  << connections << " connections\n";
+    }
+
+    // The server logs every connect/disconnect; keep that out of the results.
+    Logger::setLevel(LogLevel::Warn);
+
+    struct Case { size_t accepts, batch; };
+    const Case cases[] = {{1, 1}, {1, 64}, {4, 1}, {4, 64}, {16, 64}};
+
+    std::ostringstream report;
+    report << "accept benchmark: " << connections << " connections, "
+           << ioThreads << " io threads\n";
+    report << std::left << std::setw(10) << "accepts" << std::setw(8) << "batch"
+           << std::setw(12) << "accepted" << std::setw(12) << "seconds" << "conn/s\n";
+
+    for (const Case& c : cases) {
+        Result r = runOnce(connections, ioThreads, c.accepts, c.batch);
+        report << std::left << std::setw(10) << c.accepts << std::setw(8) << c.batch
+               << std::setw(12) << r.accepted << std::setw(12) << std::fixed << std::setprecision(3)
+               << r.seconds << std::setprecision(0) << (r.accepted / r.seconds) << "\n";
+    }
+
+    std::cout << report.str();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "../frame.hpp"
+#include "../message.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+/*
+ * ============================================================================
+ * CODEC BENCHMARK - What does each Message operation cost, by size?
+ * ============================================================================
+ *
+ * Everything on the per-frame path goes through message.hpp: decodeHeader()
+ * on every read, the string constructor on every client send, and
+ * makeFrame() once per broadcast (before broadcasts shared one Frame, that
+ * was a Message copy per recipient).
+ * These are tiny functions, so a regression in one of them - an extra
+ * allocation, a sprintf where a few stores would do - is invisible in a
+ * load test until it's multiplied by the fan-out.
+ *
+ * Each case runs in rounds until it has ~50ms of samples; reported:
+ *   ns/op      wall time per call
+ *   MB/s       frame bytes (header + body) processed per second
+ *   allocs/op  global operator new calls per op (counted by replacing it)
+ *
+ * This file is built with -O2 (see the Makefile) whatever the rest of the
+ * tree uses - the codec is header-only, so that's what gets measured.
+ *
+ *   ./bench/codecBench
+ * ============================================================================
+ */
+
+static uint64_t allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Keep the optimiser from discarding a result it can prove is unused.
+template <typename T>
+static void keep(T&& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+template <typename Fn>
+static Result measure(Fn&& fn) {
+    const auto target = std::chrono::milliseconds(50);
+    size_t batch = 1024;
+    Clock::duration spent{0};
+    uint64_t ops = 0;
+    uint64_t allocs = 0;
+    while (spent < target) {
+        uint64_t before = allocations;
+        auto start = Clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            fn();
+        }
+        spent += Clock::now() - start;
+        allocs += allocations - before;
+        ops += batch;
+        batch *= 2;
+    }
+    return {std::chrono::duration<double, std::nano>(spent).count() / ops, double(allocs) / ops};
+}
+
+static void row(const std::string& name, size_t bodyBytes, const Result& r) {
+    double bytes = double(Message::header + bodyBytes);
+    std::cout << std::left << std::setw(16) << name << std::right << std::setw(6) << bodyBytes
+              << std::fixed << std::setprecision(1) << std::setw(12) << r.nsPerOp
+              << std::setprecision(0) << std::setw(12) << bytes / r.nsPerOp * 1e3
+              << std::setprecision(2) << std::setw(12) << r.allocsPerOp << "\n";
+}
+
+int main() {
+    const size_t sizes[] = {1, 16, 64, 256, Message::maxBytes};
+
+    std::cout << std::left << std::setw(16) << "case" << std::right << std::setw(6) << "bytes"
+              << std::setw(12) << "ns/op" << std::setw(12) << "MB/s" << std::setw(12) << "allocs/op" << "\n";
+
+    for (size_t size : sizes) {
+        const std::string body(size, 'x');
+        Message encoded(body);
+
+        row("construct", size, measure([&]() {
+            Message msg(body);
+            keep(msg);
+        }));
+
+        row("encodeHeader", size, measure([&]() {
+            encoded.encodeHeader();
+            keep(encoded);
+        }));
+
+        row("decodeHeader", size, measure([&]() {
+            bool ok = encoded.decodeHeader();
+            keep(ok);
+        }));
+
+        row("getBody", size, measure([&]() {
+            std::string copy = encoded.getBody();
+            keep(copy);
+        }));
+
+        row("getData", size, measure([&]() {
+            std::string copy = encoded.getData();
+            keep(copy);
+        }));
+
+        // What one recipient used to cost: a full Message copy into its queue.
+        row("copy", size, measure([&]() {
+            Message copy = encoded;
+            keep(copy);
+        }));
+
+        // What replaced it: one shared frame per broadcast.
+        row("makeFrame", size, measure([&]() {
+            FramePtr frame = makeFrame(encoded);
+            keep(frame);
+        }));
+
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include "../chatRoom.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * FAN-OUT BENCHMARK - Room::deliver() and Room::join() without sockets
+ * ============================================================================
+ *
+ * Participant is an interface, so the Room can be filled with mocks and
+ * driven from one thread - no io_context, no kernel, just the fan-out loop
+ * and whatever the recipient does with the frame:
+ *
+ *   noop      deliver() returns immediately: the cost of walking the set
+ *   counting  bumps a counter in the participant: one cache line touched
+ *             per recipient, like any real deliver() would
+ *   queueing  what Session::deliver() does: allocate a node holding the
+ *             FramePtr and push it on an MpscQueue. Draining (the write
+ *             chain's side) happens outside the timed section.
+ *
+ * Each room size runs enough rounds for ~100k deliveries. Reported per
+ * delivery (one recipient of one broadcast): ns, and - when the kernel
+ * lets us open perf counters - cache misses and instructions. Those two
+ * are the numbers to watch when changing the participant container: the
+ * std::set walk chases a pointer per node and the participant a pointer
+ * per shared_ptr.
+ *
+ * join: a fresh participant joining a room whose 50-frame history is full,
+ * then leaving again. That's the set insert + erase plus 50 replayed
+ * deliveries.
+ *
+ * Numbers are for whatever CXXFLAGS built chatRoom.o - compare builds made
+ * with the same flags.
+ *
+ *   ./bench/fanoutBench [max-participants]
+ * ============================================================================
+ */
+
+using Clock = std::chrono::steady_clock;
+
+struct NoopParticipant : Participant {
+    using Participant::deliver;
+    void deliver(const FramePtr&) override {}
+    void write(Message&) override {}
+};
+
+struct CountingParticipant : Participant {
+    using Participant::deliver;
+    void deliver(const FramePtr& frame) override {
+        ++frames;
+        bytes += frame->msg.getBodyLength();
+    }
+    void write(Message&) override {}
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+};
+
+struct QueueingParticipant : Participant {
+    struct Node : MpscNode {
+        explicit Node(const FramePtr& f) : frame(f) {}
+        FramePtr frame;
+    };
+    using Participant::deliver;
+    void deliver(const FramePtr& frame) override { inbox.push(new Node(frame)); }
+    void write(Message&) override {}
+    void drain() {
+        while (MpscNode* node = inbox.pop()) {
+            delete static_cast<Node*>(node);
+        }
+    }
+    MpscQueue inbox;
+};
+
+/*
+ * Hardware counters for this thread, if perf_event_paranoid (or the
+ * container) allows it. Otherwise every read returns -1 and the columns
+ * print "-".
+ */
+class PerfCounter {
+public:
+    explicit PerfCounter(uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~PerfCounter() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    void start() {
+        if (fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    int64_t stop() {
+        if (fd < 0) {
+            return -1;
+        }
+        ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t value = 0;
+        if (::read(fd, &value, sizeof(value)) != sizeof(value)) {
+            return -1;
+        }
+        return static_cast<int64_t>(value);
+    }
+
+private:
+    int fd = -1;
+};
+
+struct Sample {
+    Clock::duration time{0};
+    int64_t cacheMisses = 0;
+    int64_t instructions = 0;
+};
+
+static PerfCounter cacheMisses(PERF_COUNT_HW_CACHE_MISSES);
+static PerfCounter instructions(PERF_COUNT_HW_INSTRUCTIONS);
+
+template <typename Fn>
+static void timed(Sample& sample, Fn&& fn) {
+    cacheMisses.start();
+    instructions.start();
+    auto start = Clock::now();
+    fn();
+    sample.time += Clock::now() - start;
+    int64_t misses = cacheMisses.stop();
+    int64_t instr = instructions.stop();
+    sample.cacheMisses = misses < 0 || sample.cacheMisses < 0 ? -1 : sample.cacheMisses + misses;
+    sample.instructions = instr < 0 || sample.instructions < 0 ? -1 : sample.instructions + instr;
+}
+
+static std::string perUnit(int64_t total, uint64_t units) {
+    if (total < 0) {
+        return "-";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << double(total) / double(units);
+    return out.str();
+}
+
+static void row(const std::string& variant, size_t participants, const Sample& s, uint64_t deliveries,
+                uint64_t calls) {
+    double ns = std::chrono::duration<double, std::nano>(s.time).count();
+    std::cout << std::left << std::setw(10) << variant << std::right << std::setw(8) << participants
+              << std::fixed << std::setprecision(1) << std::setw(14) << ns / calls
+              << std::setw(12) << ns / deliveries
+              << std::setprecision(0) << std::setw(14) << deliveries / (ns / 1e9)
+              << std::setw(14) << perUnit(s.cacheMisses, deliveries)
+              << std::setw(14) << perUnit(s.instructions, deliveries) << "\n";
+}
+
+template <typename Mock>
+static void benchDeliver(const std::string& variant, size_t participants, const FramePtr& frame) {
+    Room room("bench");
+    std::vector<std::shared_ptr<Mock>> mocks;
+    for (size_t i = 0; i < participants; ++i) {
+        mocks.push_back(std::make_shared<Mock>());
+        room.join(mocks.back());
+    }
+
+    // Rounds of `batch` broadcasts; queueing mocks are drained between them.
+    const uint64_t targetDeliveries = 100000;
+    const size_t batch = std::max<size_t>(1, std::min<size_t>(1000, targetDeliveries / participants));
+    const size_t rounds = std::max<size_t>(1, targetDeliveries / (batch * participants));
+
+    // Warm-up: history fills to 50, allocator settles.
+    for (size_t i = 0; i < 64; ++i) {
+        room.deliver(nullptr, frame);
+    }
+    if constexpr (std::is_same_v<Mock, QueueingParticipant>) {
+        for (auto& mock : mocks) {
+            mock->drain();
+        }
+    }
+
+    Sample sample;
+    for (size_t r = 0; r < rounds; ++r) {
+        timed(sample, [&]() {
+            for (size_t i = 0; i < batch; ++i) {
+                room.deliver(nullptr, frame);
+            }
+        });
+        if constexpr (std::is_same_v<Mock, QueueingParticipant>) {
+            for (auto& mock : mocks) {
+                mock->drain();
+            }
+        }
+    }
+    row(variant, participants, sample, uint64_t(rounds) * batch * participants, uint64_t(rounds) * batch);
+}
+
+static void benchJoin(size_t participants, const FramePtr& frame) {
+    Room room("bench");
+    std::vector<std::shared_ptr<CountingParticipant>> members;
+    for (size_t i = 0; i < participants; ++i) {
+        members.push_back(std::make_shared<CountingParticipant>());
+        room.join(members.back());
+    }
+    for (size_t i = 0; i < 64; ++i) {
+        room.deliver(nullptr, frame);  // history is now full
+    }
+
+    const size_t joins = 2000;
+    std::vector<std::shared_ptr<CountingParticipant>> newcomers;
+    for (size_t i = 0; i < joins; ++i) {
+        newcomers.push_back(std::make_shared<CountingParticipant>());
+    }
+
+    Sample sample;
+    timed(sample, [&]() {
+        for (auto& newcomer : newcomers) {
+            room.join(newcomer);
+            room.leave(newcomer);
+        }
+    });
+    uint64_t replayed = newcomers.front()->frames;
+    double ns = std::chrono::duration<double, std::nano>(sample.time).count();
+    std::cout << std::left << std::setw(10) << "join" << std::right << std::setw(8) << participants
+              << std::fixed << std::setprecision(1) << std::setw(14) << ns / joins
+              << std::setw(12) << ns / (joins * replayed)
+              << std::setprecision(0) << std::setw(14) << replayed
+              << std::setw(14) << perUnit(sample.cacheMisses, joins)
+              << std::setw(14) << perUnit(sample.instructions, joins) << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxParticipants = argc > 1 ? std::stoul(argv[1]) : 10000;
+    FramePtr frame = makeFrame(Message(std::string(64, 'x')));
+
+    std::vector<size_t> sizes;
+    for (size_t n = 1; n <= maxParticipants; n *= 10) {
+        sizes.push_back(n);
+    }
+
+    std::cout << "Room::deliver() - per delivery = one recipient of one broadcast\n";
+    std::cout << std::left << std::setw(10) << "variant" << std::right << std::setw(8) << "members"
+              << std::setw(14) << "ns/deliver()" << std::setw(12) << "ns/recip"
+              << std::setw(14) << "recips/s" << std::setw(14) << "misses/recip"
+              << std::setw(14) << "instr/recip" << "\n";
+    for (size_t n : sizes) {
+        benchDeliver<NoopParticipant>("noop", n, frame);
+        benchDeliver<CountingParticipant>("counting", n, frame);
+        benchDeliver<QueueingParticipant>("queueing", n, frame);
+    }
+
+    std::cout << "\nRoom::join() + leave() with a full history\n";
+    std::cout << std::left << std::setw(10) << "case" << std::right << std::setw(8) << "members"
+              << std::setw(14) << "ns/join" << std::setw(12) << "ns/replay"
+              << std::setw(14) << "replayed" << std::setw(14) << "misses/join"
+              << std::setw(14) << "instr/join" << "\n";
+    for (size_t n : sizes) {
+        benchJoin(n, frame);
+    }
+    return 0;
+}
@@ -0,0 +1,710 @@
+#include <utility>  // must precede asio: boost 1.74 awaitable.hpp uses std::exchange
+#include "../ioPool.hpp"
+#include "../message.hpp"
+#include "../metrics.hpp"
+#include "../serverConfig.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+/*
+ * ============================================================================
+ * LOADGEN - Many scripted clients against a running chatApp
+ * ============================================================================
+ *
+ * clientApp is one human at a keyboard. This is N connections spread over
+ * a few io_contexts (the server's IoPool), a configurable subset of which
+ * send on a schedule while all of them read.
+ *
+ * Every message it sends carries its own send time:
+ *
+ *   "LG <run> <sender> <seq> <steady-ns> xxxxxxxx..."   (padded to the chosen size)
+ *
+ * so any loadgen connection that receives it can record send → receive
+ * latency without bookkeeping on the sending side. Both ends are in this
+ * process, so steady_clock is the same clock. <run> is random per
+ * invocation, which filters out history replay and other clients' chat.
+ *
+ * Load shape:
+ *   --rate R      messages per second across all senders
+ *   --burst B     send B back-to-back per tick (ticks come R/B times/s)
+ *   --poisson     exponential gaps between ticks instead of a fixed period
+ *   --size N | MIN-MAX   body bytes, fixed or uniform
+ *
+ * --channels N multiplexes: each connection sends "MUX" and opens N
+ * channels, so the Room sees connections × N participants over the same
+ * sockets. Sends go out on a connection's channels in turn; a frame the
+ * server marks "CH a,b,c" counts as received once per channel.
+ *
+ * --verify turns the run into a correctness check. <sender> is the sending
+ * connection's index and <seq> counts its messages from 0, so every
+ * receiver can follow each sender's stream (per channel, with --channels)
+ * and classify what arrives out of line:
+ *
+ *   seq == next        fine, next++
+ *   seq >  next        the ones in between are missing (for now); next = seq+1
+ *   seq <  next        missing -> it was reordered; otherwise a duplicate
+ *
+ * Whatever is still missing after the drain, plus everything past `next`
+ * that the sender did send, is lost. Any loss, duplicate, reordering or
+ * disconnect makes loadgen exit 1, so perfcheck fails on it too. A
+ * connection's own messages on its other channels aren't checked - they
+ * skip the channel that sent them, so they aren't a gap-free stream.
+ *
+ * Ticks follow an absolute schedule; a connection that falls behind sends
+ * late rather than skipping, and its latency counts from the real send.
+ * If a connection's unsent backlog passes 4 MiB the server isn't keeping
+ * up - further sends are dropped and counted as "throttled".
+ *
+ * Phases: connect everyone (a window of connects in flight), let history
+ * replay settle, send for --duration seconds, then wait for stragglers
+ * and print throughput and latency percentiles.
+ *
+ *   ./bench/loadgen <host|unix:PATH> <port> [options]
+ * ============================================================================
+ */
+
+using Clock = std::chrono::steady_clock;
+using StreamSocket = boost::asio::generic::stream_protocol::socket;
+using Endpoint = boost::asio::generic::stream_protocol::endpoint;
+using boost::asio::ip::tcp;
+
+struct LoadConfig {
+    std::string host;
+    std::string port;
+    size_t connections = 100;
+    size_t senders = 0;  // 0 = every connection
+    size_t threads = 2;
+    double rate = 1000;
+    size_t minSize = 64;
+    size_t maxSize = 64;
+    size_t burst = 1;
+    bool poisson = false;
+    size_t duration = 10;
+    size_t channels = 0;  // 0 = plain connections, no MUX
+    bool verify = false;
+};
+
+static uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Shared by every connection. Counters are the sharded metrics ones, so io
+ * threads never contend on them and the progress line can read them live.
+ */
+struct Run {
+    LoadConfig config;
+    Endpoint target;
+    uint64_t id = 0;
+
+    std::atomic<bool> measuring{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> measureStart{0};
+    std::atomic<size_t> nextToConnect{0};
+
+    Counter connected;
+    Counter connectFailed;
+    Counter disconnected;
+    Counter sent;
+    Counter sentBytes;
+    Counter throttled;
+    Counter received;
+    Counter receivedBytes;
+    Counter channelsRefused;
+    Counter duplicates;
+    Counter reordered;
+    LatencyHistogram latency;
+
+    std::function<void()> connectNext;
+
+    // The first few anomalies, so a failed --verify says where to look.
+    void report(const std::string& line) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        if (reportsLeft > 0) {
+            --reportsLeft;
+            std::cerr << "verify: " << line << "\n";
+        }
+    }
+
+private:
+    std::mutex reportMutex;
+    size_t reportsLeft = 10;
+};
+
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(boost::asio::io_context& io, Run& run, size_t index, bool sender)
+        : socket(io), timer(io), run(run), index(index), sender(sender), rng(index * 7919 + run.id),
+          inbound(16384) {
+        if (run.config.verify) {
+            nextSeq.assign(std::max<size_t>(run.config.channels, 1) * run.config.senders, 0);
+        }
+    }
+
+    boost::asio::any_io_executor executor() { return socket.get_executor(); }
+
+    // Messages this connection sent; read once the io threads are joined.
+    uint64_t sentCount() const { return seq; }
+
+    /*
+     * --verify: what never arrived here, given how many each sender sent.
+     * Only meaningful after the io threads are joined.
+     */
+    uint64_t lost(const std::vector<uint64_t>& sentBy) const {
+        uint64_t total = missing.size();
+        for (size_t stream = 0; stream < nextSeq.size(); ++stream) {
+            size_t from = stream % run.config.senders;
+            if (from != index && sentBy[from] > nextSeq[stream]) {
+                total += sentBy[from] - nextSeq[stream];
+            }
+        }
+        return total;
+    }
+
+    void connect() {
+        auto self = shared_from_this();
+        socket.async_connect(run.target, [this, self](boost::system::error_code ec) {
+            if (ec) {
+                run.connectFailed.inc();
+            } else {
+                if (run.target.protocol().family() != AF_UNIX) {
+                    boost::system::error_code ignored;
+                    socket.set_option(tcp::no_delay(true), ignored);
+                }
+                run.connected.inc();
+                openChannels();
+                readSome();
+            }
+            run.connectNext();
+        });
+    }
+
+    void startSending() {
+        if (!sender || !socket.is_open()) {
+            return;
+        }
+        double perSender = run.config.rate / double(run.config.senders);
+        period = std::chrono::duration<double>(double(run.config.burst) / perSender);
+        // Random phase, so senders don't all fire on the same tick.
+        std::uniform_real_distribution<double> phase(0.0, period.count());
+        next = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(phase(rng)));
+        scheduleTick();
+    }
+
+private:
+    static const size_t maxBacklog = 4 * 1024 * 1024;
+
+    void openChannels() {
+        if (run.config.channels == 0) {
+            return;
+        }
+        Message mux = Message::control("MUX");
+        pending.append(mux.data, Message::header + mux.getBodyLength());
+        for (size_t channel = 1; channel <= run.config.channels; ++channel) {
+            Message open = Message::control("OPEN", std::to_string(channel));
+            pending.append(open.data, Message::header + open.getBodyLength());
+        }
+        flush();
+    }
+
+    void scheduleTick() {
+        auto self = shared_from_this();
+        timer.expires_at(next);
+        timer.async_wait([this, self](boost::system::error_code ec) {
+            if (ec || run.stopping.load(std::memory_order_relaxed) || !socket.is_open()) {
+                return;
+            }
+            for (size_t i = 0; i < run.config.burst; ++i) {
+                queueMessage();
+            }
+            flush();
+
+            double gap = period.count();
+            if (run.config.poisson) {
+                gap = std::exponential_distribution<double>(1.0 / period.count())(rng);
+            }
+            next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap));
+            scheduleTick();
+        });
+    }
+
+    void queueMessage() {
+        if (pending.size() >= maxBacklog) {
+            run.throttled.inc();
+            return;
+        }
+        std::uniform_int_distribution<size_t> sizes(run.config.minSize, run.config.maxSize);
+        size_t size = sizes(rng);
+
+        char stamp[96];
+        int stampLength = std::snprintf(stamp, sizeof(stamp), "LG %llu %llu %llu %llu ",
+                                        (unsigned long long)run.id, (unsigned long long)index,
+                                        (unsigned long long)seq++, (unsigned long long)nowNanos());
+        std::string body(stamp, stampLength);
+        if (body.size() < size) {
+            body.append(size - body.size(), 'x');
+        }
+        Message msg(body);
+        if (run.config.channels != 0) {
+            Message tag = Message::control("CH", std::to_string(seq % run.config.channels + 1));
+            pending.append(tag.data, Message::header + tag.getBodyLength());
+        }
+        pending.append(msg.data, Message::header + msg.getBodyLength());
+        run.sent.inc();
+        run.sentBytes.inc(Message::header + msg.getBodyLength());
+    }
+
+    void queueControl(const Message& msg) {
+        pending.append(msg.data, Message::header + msg.getBodyLength());
+        flush();
+    }
+
+    // Double buffer: keep appending to `pending` while `writing` is on the wire.
+    void flush() {
+        if (writeActive || pending.empty() || !socket.is_open()) {
+            return;
+        }
+        writing.swap(pending);
+        writeActive = true;
+        auto self = shared_from_this();
+        boost::asio::async_write(socket, boost::asio::buffer(writing),
+            [this, self](boost::system::error_code ec, std::size_t) {
+                writeActive = false;
+                writing.clear();
+                if (ec) {
+                    close();
+                    return;
+                }
+                flush();
+            });
+    }
+
+    void readSome() {
+        auto self = shared_from_this();
+        socket.async_read_some(boost::asio::buffer(inbound.data() + used, inbound.size() - used),
+            [this, self](boost::system::error_code ec, std::size_t length) {
+                if (ec) {
+                    close();
+                    return;
+                }
+                used += length;
+                if (!parseFrames()) {
+                    close();
+                    return;
+                }
+                readSome();
+            });
+    }
+
+    bool parseFrames() {
+        size_t offset = 0;
+        while (used - offset >= Message::header) {
+            char header[Message::header + 1] = "";
+            std::memcpy(header, inbound.data() + offset, Message::header);
+            int bodyLength = std::atoi(header);
+            if (bodyLength < 0 || bodyLength > int(Message::maxBytes)) {
+                std::cerr << "loadgen: bad frame header from server\n";
+                return false;
+            }
+            if (used - offset < Message::header + size_t(bodyLength)) {
+                break;
+            }
+            onFrame(inbound.data() + offset + Message::header, size_t(bodyLength));
+            offset += Message::header + bodyLength;
+        }
+        std::memmove(inbound.data(), inbound.data() + offset, used - offset);
+        used -= offset;
+        return true;
+    }
+
+    void onFrame(const char* body, size_t length) {
+        if (length > 0 && body[0] == Message::controlMarker) {
+            // Keep idle listeners alive through the server's heartbeat.
+            if (length >= 5 && std::memcmp(body + 1, "PING", 4) == 0) {
+                std::string args = length > 6 ? std::string(body + 6, length - 6) : "";
+                queueControl(Message::control("PONG", args));
+            } else if (length >= 4 && std::memcmp(body + 1, "CH ", 3) == 0) {
+                parseTargets(body + 4, length - 4);
+            } else if (length >= 7 && std::memcmp(body + 1, "CLOSE ", 6) == 0) {
+                run.channelsRefused.inc();
+            } else if (length == 16 && std::memcmp(body + 1, "MUX unavailable", 15) == 0) {
+                std::cerr << "loadgen: server refused MUX\n";
+                close();
+            }
+            return;
+        }
+        onChat(body, length);
+        targets.clear();
+    }
+
+    void onChat(const char* body, size_t length) {
+        size_t frameCopies = targets.empty() ? 1 : targets.size();
+        if (length < 3 || std::memcmp(body, "LG ", 3) != 0) {
+            return;
+        }
+        char text[Message::maxBytes + 1];
+        std::memcpy(text, body, length);
+        text[length] = '\0';
+        unsigned long long runId = 0, from = 0, sequence = 0, sentAt = 0;
+        if (std::sscanf(text, "LG %llu %llu %llu %llu", &runId, &from, &sequence, &sentAt) != 4 ||
+            runId != run.id) {
+            return;
+        }
+        if (!run.measuring.load(std::memory_order_relaxed) ||
+            sentAt < run.measureStart.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (run.config.verify && from < run.config.senders && from != index) {
+            if (targets.empty()) {
+                verify(0, from, sequence);
+            }
+            for (uint32_t channel : targets) {
+                verify(channel, from, sequence);
+            }
+        }
+        uint64_t now = nowNanos();
+        for (size_t i = 0; i < frameCopies; ++i) {
+            run.latency.record(now > sentAt ? now - sentAt : 0);
+        }
+        run.received.inc(frameCopies);
+        run.receivedBytes.inc(Message::header + length);
+    }
+
+    // The ids in "CH a,b,c" - the channels the next chat frame is for.
+    void parseTargets(const char* list, size_t length) {
+        targets.clear();
+        uint32_t id = 0;
+        for (size_t i = 0; i <= length; ++i) {
+            if (i == length || list[i] == ',') {
+                targets.push_back(id);
+                id = 0;
+            } else {
+                id = id * 10 + uint32_t(list[i] - '0');
+            }
+        }
+    }
+
+    void verify(uint32_t channel, size_t from, uint64_t sequence) {
+        size_t slot = channel == 0 ? 0 : channel - 1;
+        if (slot >= std::max<size_t>(run.config.channels, 1)) {
+            return;
+        }
+        size_t stream = slot * run.config.senders + from;
+        uint64_t& next = nextSeq[stream];
+        if (sequence == next) {
+            ++next;
+            return;
+        }
+        if (sequence > next) {
+            for (uint64_t gap = next; gap < sequence; ++gap) {
+                missing.emplace(stream, gap);
+            }
+            next = sequence + 1;
+            return;
+        }
+        const char* what = "duplicate";
+        if (missing.erase({stream, sequence}) != 0) {
+            run.reordered.inc();
+            what = "late";
+        } else {
+            run.duplicates.inc();
+        }
+        run.report(std::string(what) + " seq " + std::to_string(sequence) + " from sender " +
+                   std::to_string(from) + " at connection " + std::to_string(index) +
+                   (channel != 0 ? " channel " + std::to_string(channel) : "") + ", expected " +
+                   std::to_string(next));
+    }
+
+    void close() {
+        if (!socket.is_open()) {
+            return;
+        }
+        if (!run.stopping.load(std::memory_order_relaxed)) {
+            run.disconnected.inc();
+        }
+        boost::system::error_code ignored;
+        timer.cancel();
+        socket.close(ignored);
+    }
+
+    StreamSocket socket;
+    boost::asio::steady_timer timer;
+    Run& run;
+    size_t index;
+    bool sender;
+    std::mt19937_64 rng;
+    uint64_t seq = 0;
+
+    // --verify: next expected seq per (channel, sender), and the gaps left.
+    std::vector<uint64_t> nextSeq;
+    std::set<std::pair<size_t, uint64_t>> missing;
+
+    std::chrono::duration<double> period{0};
+    Clock::time_point next;
+
+    std::vector<char> inbound;
+    size_t used = 0;
+    std::vector<uint32_t> targets;  // channels named by the last "CH", for the next frame
+    std::string pending;
+    std::string writing;
+    bool writeActive = false;
+};
+
+static const char* usage() {
+    return "Usage: ./bench/loadgen <host|unix:PATH> <port> [--connections N] [--senders N] [--threads N]\n"
+           "                      [--rate MSGS_PER_SEC] [--size N|MIN-MAX] [--burst N] [--poisson]\n"
+           "                      [--duration S] [--channels N] [--verify]";
+}
+
+static LoadConfig parseArgs(int argc, char* argv[]) {
+    if (argc < 3) {
+        throw std::invalid_argument("expected <host> <port>");
+    }
+    LoadConfig config;
+    config.host = argv[1];
+    config.port = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--poisson") {
+            config.poisson = true;
+            continue;
+        }
+        if (flag == "--verify") {
+            config.verify = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(flag + " needs a value");
+        }
+        const char* value = argv[++i];
+        if (flag == "--connections") {
+            config.connections = parsePositive(flag, value);
+        } else if (flag == "--senders") {
+            config.senders = parsePositive(flag, value);
+        } else if (flag == "--threads") {
+            config.threads = parsePositive(flag, value);
+        } else if (flag == "--rate") {
+            config.rate = double(parsePositive(flag, value));
+        } else if (flag == "--burst") {
+            config.burst = parsePositive(flag, value);
+        } else if (flag == "--channels") {
+            config.channels = parsePositive(flag, value);
+        } else if (flag == "--duration") {
+            config.duration = parsePositive(flag, value);
+        } else if (flag == "--size") {
+            std::string text = value;
+            size_t dash = text.find('-');
+            config.minSize = parsePositive(flag, text.substr(0, dash).c_str());
+            config.maxSize = dash == std::string::npos ? config.minSize
+                                                       : parsePositive(flag, text.substr(dash + 1).c_str());
+            if (config.maxSize < config.minSize || config.maxSize > Message::maxBytes) {
+                throw std::invalid_argument("--size expects N or MIN-MAX, at most " +
+                                            std::to_string(Message::maxBytes));
+            }
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    if (config.senders == 0 || config.senders > config.connections) {
+        config.senders = config.connections;
+    }
+    return config;
+}
+
+static Endpoint resolveTarget(const LoadConfig& config) {
+    if (config.host.rfind("unix:", 0) == 0) {
+        return Endpoint(boost::asio::local::stream_protocol::endpoint(config.host.substr(5)));
+    }
+    boost::asio::io_context io;
+    tcp::resolver resolver(io);
+    auto results = resolver.resolve(config.host, config.port);
+    if (results.empty()) {
+        throw std::runtime_error("cannot resolve " + config.host);
+    }
+    return Endpoint(results.begin()->endpoint());
+}
+
+static double micros(uint64_t nanos) {
+    return double(nanos) / 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    Run run;
+    try {
+        run.config = parseArgs(argc, argv);
+        run.target = resolveTarget(run.config);
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n" << usage() << std::endl;
+        return 1;
+    }
+    const LoadConfig& config = run.config;
+    run.id = std::random_device()() | 1;
+
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < config.connections + 64) {
+        std::cerr << "warning: RLIMIT_NOFILE " << limit.rlim_cur << " is too low for "
+                  << config.connections << " connections\n";
+    }
+
+    IoPool pool(config.threads);
+    std::vector<std::shared_ptr<Connection>> connections;
+    connections.reserve(config.connections);
+    for (size_t i = 0; i < config.connections; ++i) {
+        connections.push_back(std::make_shared<Connection>(pool.at(i % config.threads), run, i,
+                                                           i < config.senders));
+    }
+
+    // A window of connects in flight, so the listen backlog doesn't overflow.
+    run.connectNext = [&]() {
+        size_t index = run.nextToConnect.fetch_add(1, std::memory_order_relaxed);
+        if (index < connections.size()) {
+            auto connection = connections[index];
+            boost::asio::post(connection->executor(), [connection]() { connection->connect(); });
+        }
+    };
+
+    std::cout << "loadgen: " << config.connections << " connections (" << config.senders << " sending), "
+              << config.threads << " io threads, " << config.rate << " msgs/s, size " << config.minSize
+              << "-" << config.maxSize << ", burst " << config.burst
+              << (config.poisson ? ", poisson" : ", fixed period") << ", " << config.duration << "s";
+    if (config.channels != 0) {
+        std::cout << ", " << config.channels << " MUX channels each";
+    }
+    if (config.verify) {
+        std::cout << ", verifying order";
+    }
+    std::cout << "\n";
+
+    pool.start();
+    auto connectStart = Clock::now();
+    for (size_t i = 0; i < 256; ++i) {
+        run.connectNext();
+    }
+    auto connectDeadline = connectStart + std::chrono::seconds(60);
+    while (run.connected.value() + run.connectFailed.value() < config.connections &&
+           Clock::now() < connectDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cout << "connected " << run.connected.value() << "/" << config.connections << " in "
+              << std::fixed << std::setprecision(2)
+              << std::chrono::duration<double>(Clock::now() - connectStart).count() << "s";
+    if (run.connectFailed.value() > 0) {
+        std::cout << " (" << run.connectFailed.value() << " failed)";
+    }
+    std::cout << std::endl;
+    if (run.connected.value() == 0) {
+        return 1;
+    }
+
+    // Let each newcomer's history replay drain before the clock starts.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    run.measureStart.store(nowNanos());
+    run.measuring.store(true);
+    auto sendStart = Clock::now();
+    for (auto& connection : connections) {
+        boost::asio::post(connection->executor(), [connection]() { connection->startSending(); });
+    }
+
+    uint64_t lastSent = 0;
+    uint64_t lastReceived = 0;
+    for (size_t second = 1; second <= config.duration; ++second) {
+        std::this_thread::sleep_until(sendStart + std::chrono::seconds(second));
+        uint64_t sent = run.sent.value();
+        uint64_t received = run.received.value();
+        std::cout << "  t=" << second << "s  sent " << (sent - lastSent) << "/s  received "
+                  << (received - lastReceived) << "/s" << std::endl;
+        lastSent = sent;
+        lastReceived = received;
+    }
+    run.stopping.store(true);
+    double sendSeconds = std::chrono::duration<double>(Clock::now() - sendStart).count();
+
+    /*
+     * Drain: stop once nothing has arrived for 200ms (or after 5s). When
+     * verifying, an overloaded server's backlog is still owed, not lost:
+     * wait while it keeps arriving (up to 60s), until all of it is in or
+     * nothing has come for a second.
+     */
+    auto drainDeadline = Clock::now() + std::chrono::seconds(config.verify ? 60 : 5);
+    uint64_t seen = run.received.value();
+    uint64_t participants = run.connected.value() * std::max<size_t>(config.channels, 1);
+    size_t quietPolls = 0;
+    while (Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        uint64_t now = run.received.value();
+        quietPolls = now == seen ? quietPolls + 1 : 0;
+        if (!config.verify ? quietPolls > 0
+                           : now >= run.sent.value() * (participants - 1) || quietPolls >= 5) {
+            break;
+        }
+        seen = now;
+    }
+
+    pool.stop();
+    pool.join();
+
+    uint64_t sent = run.sent.value();
+    uint64_t received = run.received.value();
+    uint64_t expected = sent * (participants - 1);
+    LatencyHistogram::Snapshot latency = run.latency.snapshot();
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "sent       " << sent << " msgs  " << sent / sendSeconds << " msgs/s  "
+              << std::setprecision(2) << run.sentBytes.value() / sendSeconds / 1e6 << " MB/s\n"
+              << std::setprecision(0)
+              << "received   " << received << " msgs  " << received / sendSeconds << " msgs/s  "
+              << std::setprecision(2) << run.receivedBytes.value() / sendSeconds / 1e6 << " MB/s  ("
+              << (expected ? 100.0 * double(received) / double(expected) : 0.0) << "% of "
+              << expected << " expected)\n";
+    if (run.channelsRefused.value() > 0) {
+        std::cout << "refused    " << run.channelsRefused.value()
+                  << " channels over the server's --mux-channels; expected counts them anyway\n";
+    }
+    if (run.throttled.value() > 0 || run.disconnected.value() > 0) {
+        std::cout << "throttled  " << run.throttled.value() << " sends, disconnected "
+                  << run.disconnected.value() << " connections\n";
+    }
+    std::cout << std::setprecision(1)
+              << "latency us p50 " << micros(latency.quantile(0.5))
+              << "  p90 " << micros(latency.quantile(0.9))
+              << "  p99 " << micros(latency.quantile(0.99))
+              << "  p99.9 " << micros(latency.quantile(0.999))
+              << "  max " << micros(latency.max) << std::endl;
+
+    bool failed = false;
+    if (config.verify) {
+        std::vector<uint64_t> sentBy(config.senders);
+        for (size_t i = 0; i < config.senders; ++i) {
+            sentBy[i] = connections[i]->sentCount();
+        }
+        uint64_t lost = 0;
+        for (auto& connection : connections) {
+            lost += connection->lost(sentBy);
+        }
+        failed = lost != 0 || run.duplicates.value() != 0 || run.reordered.value() != 0 ||
+                 run.disconnected.value() != 0 || run.connectFailed.value() != 0;
+        std::cout << "verify     lost " << lost << "  duplicated " << run.duplicates.value()
+                  << "  reordered " << run.reordered.value() << "  disconnected "
+                  << run.disconnected.value() << "  -> " << (failed ? "FAILED" : "ok") << std::endl;
+    }
+
+    connections.clear();
+    return failed ? 1 : 0;
+}
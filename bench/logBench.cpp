@@ -0,0 +1,114 @@
+#include "../log.hpp"
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/*
+ * ============================================================================
+ * LOG BENCHMARK - What does one log call cost the thread that makes it?
+ * ============================================================================
+ *
+ * Only the caller's side is timed - that's what an io thread pays. Calls
+ * are issued in bursts smaller than a ring, with a pause in between so the
+ * formatter (writing to /dev/null) keeps up and nothing is dropped; the
+ * pauses aren't counted.
+ *
+ * Cases:
+ *   cout+endl     the old way: std::ostream to /dev/null, flushed per line
+ *   disabled      below the level threshold
+ *   enabled       one string + one integer argument, into the ring
+ *   rate-limited  same statement past its per-second budget
+ *
+ * The enabled case is also run from several threads at once - each has its
+ * own ring, so the per-call cost should not move. A non-zero "dropped"
+ * column means the formatter fell behind (it's slow in an -O0 build).
+ *
+ *   ./bench/logBench [calls-per-thread] [threads]
+ * ============================================================================
+ */
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t burst = 2000;  // comfortably below LogRing::capacity
+
+template <typename Fn>
+static double nsPerCall(size_t calls, Fn&& fn) {
+    Clock::duration spent{0};
+    for (size_t done = 0; done < calls; done += burst) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < burst; ++i) {
+            fn(done + i);
+        }
+        spent += Clock::now() - start;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return std::chrono::duration<double, std::nano>(spent).count() / calls;
+}
+
+static void row(const std::string& name, double ns) {
+    std::cout << std::left << std::setw(26) << name << std::fixed << std::setprecision(1)
+              << ns << " ns/call  dropped so far " << Logger::droppedCount() << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t calls = argc > 1 ? std::stoul(argv[1]) : 200000;
+    size_t threads = argc > 2 ? std::stoul(argv[2]) : 4;
+    calls = (calls + burst - 1) / burst * burst;
+
+    int devNull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    Logger::setRateLimit(0);
+    Logger::start(devNull);
+
+    std::string reason = "Connection reset by peer";
+    std::cout << "log benchmark: " << calls << " calls per case\n";
+
+    {
+        std::ofstream out("/dev/null");
+        row("cout+endl", nsPerCall(calls, [&](size_t i) {
+            out << "Read error: " << reason << " " << i << std::endl;
+        }));
+    }
+
+    Logger::setLevel(LogLevel::Warn);
+    row("disabled", nsPerCall(calls, [&](size_t i) {
+        LOG_INFO("Read error: {} {}", reason, i);
+    }));
+
+    Logger::setLevel(LogLevel::Info);
+    row("enabled", nsPerCall(calls, [&](size_t i) {
+        LOG_INFO("Read error: {} {}", reason, i);
+    }));
+
+    Logger::setRateLimit(20);
+    row("rate-limited", nsPerCall(calls, [&](size_t i) {
+        LOG_INFO("Read error: {} {}", reason, i);
+    }));
+    Logger::setRateLimit(0);
+
+    std::vector<double> perThread(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            perThread[t] = nsPerCall(calls, [&](size_t i) {
+                LOG_INFO("Read error: {} {}", reason, i);
+            });
+        });
+    }
+    double total = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        workers[t].join();
+        total += perThread[t];
+    }
+    row("enabled x" + std::to_string(threads) + " threads", total / threads);
+
+    Logger::stop();
+    std::cout << "dropped records: " << Logger::droppedCount() << "\n";
+    ::close(devNull);
+    return 0;
+}
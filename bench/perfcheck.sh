@@ -0,0 +1,190 @@
+#!/usr/bin/env bash
+#
+# ============================================================================
+# PERFCHECK - Catching regressions before they ship
+# ============================================================================
+#
+# Starts chatApp on a loopback port, drives it with a fixed set of loadgen
+# scenarios, and compares what it measured against bench/perfBaseline.json:
+#
+#   <scenario>.msgs_per_sec   received msgs/s      fails if it drops
+#   <scenario>.p99_us         loadgen p99 latency  fails if it grows
+#   <scenario>.peak_rss_kb    chatApp VmHWM so far fails if it grows
+#
+# by more than the tolerance for that kind of number (tolerance.* in the
+# baseline; PERFCHECK_TOLERANCE=0.3 overrides all three). Only keys present
+# in the baseline are checked, so a number too noisy to gate on can simply
+# be left out of it.
+#
+# Speed doesn't count if messages go missing: a scenario run with loadgen
+# --verify fails the check outright on any loss, duplicate or reordering,
+# whatever the numbers say.
+#
+# Baselines are machine-specific. After a deliberate change, or on a new
+# machine, record a fresh one and commit it with the change:
+#
+#   make perfcheck                   # compare, exit 1 on a regression
+#   ./bench/perfcheck.sh --update    # rewrite the baseline from this run
+#
+# PERFCHECK_PORT picks the port (default 19411).
+# ============================================================================
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+BASELINE=bench/perfBaseline.json
+PORT=${PERFCHECK_PORT:-19411}
+UPDATE=0
+if [[ "${1:-}" == "--update" ]]; then
+    UPDATE=1
+fi
+
+# name | loadgen options | checked metrics
+#
+# fanout:   a busy room at a rate the server keeps up with - latency and
+#           footprint matter.
+# saturate: offered load far above capacity, so received msgs/s is the
+#           server's ceiling; latency and memory there are just queueing
+#           depth and aren't gated. It runs after fanout so its backlog
+#           can't inflate fanout's peak RSS.
+# order:    bursts from many senders, every stream checked for gaps,
+#           duplicates and reordering. Nothing gated but correctness; its
+#           drain waits out the whole backlog, which would skew msgs/s.
+SCENARIOS=(
+    "fanout|--connections 50 --senders 5 --rate 500 --size 64-512 --duration 5|msgs_per_sec p99_us peak_rss_kb"
+    "saturate|--connections 20 --rate 200000 --size 256 --duration 5|msgs_per_sec"
+    "order|--connections 50 --senders 20 --rate 20000 --size 32-512 --burst 8 --duration 5 --verify|"
+)
+
+# ----------------------------------------------------------------------------
+# Baseline access: a flat JSON object of "key": number, one per line.
+# ----------------------------------------------------------------------------
+
+baseline_value() {
+    sed -n "s/^ *\"$1\": *\([0-9.eE+-]*\),\{0,1\}$/\1/p" "$BASELINE"
+}
+
+# ----------------------------------------------------------------------------
+# Run
+# ----------------------------------------------------------------------------
+
+SERVER_LOG=$(mktemp)
+./chatApp "$PORT" --threads 2 --log-level warn >"$SERVER_LOG" 2>&1 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null || true; rm -f "$SERVER_LOG"' EXIT
+
+for _ in $(seq 50); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+        break
+    fi
+    sleep 0.1
+done
+
+declare -A MEASURED
+for scenario in "${SCENARIOS[@]}"; do
+    IFS='|' read -r name options metrics <<<"$scenario"
+    echo "== $name: loadgen $options"
+    # shellcheck disable=SC2086
+    if ! output=$(./bench/loadgen 127.0.0.1 "$PORT" $options); then
+        echo "$output" | grep -E '^(sent|received|throttled|latency|verify)' || true
+        echo "perfcheck: loadgen failed in $name" >&2
+        exit 1
+    fi
+    echo "$output" | grep -E '^(sent|received|throttled|latency|verify)'
+
+    MEASURED[$name.msgs_per_sec]=$(echo "$output" | awk '/^received/ { print $4 }')
+    MEASURED[$name.p99_us]=$(echo "$output" | awk '/^latency/ { for (i = 1; i < NF; ++i) if ($i == "p99") print $(i + 1) }')
+    MEASURED[$name.peak_rss_kb]=$(awk '/^VmHWM/ { print $2 }' "/proc/$SERVER/status")
+    for metric in $metrics; do
+        if [[ -z "${MEASURED[$name.$metric]}" ]]; then
+            echo "perfcheck: no $metric in loadgen output for $name" >&2
+            exit 2
+        fi
+    done
+done
+
+kill -INT "$SERVER"
+wait "$SERVER" || true
+
+# ----------------------------------------------------------------------------
+# Update or compare
+# ----------------------------------------------------------------------------
+
+if [[ $UPDATE -eq 1 ]]; then
+    # Keep hand-tuned tolerances across updates.
+    tolThroughput=$( [[ -f $BASELINE ]] && baseline_value tolerance.throughput || true)
+    tolLatency=$( [[ -f $BASELINE ]] && baseline_value tolerance.latency || true)
+    tolMemory=$( [[ -f $BASELINE ]] && baseline_value tolerance.memory || true)
+    entries=(
+        "\"tolerance.throughput\": ${tolThroughput:-0.2}"
+        "\"tolerance.latency\": ${tolLatency:-0.5}"
+        "\"tolerance.memory\": ${tolMemory:-0.25}"
+    )
+    for scenario in "${SCENARIOS[@]}"; do
+        IFS='|' read -r name _ metrics <<<"$scenario"
+        for metric in $metrics; do
+            entries+=("\"$name.$metric\": ${MEASURED[$name.$metric]}")
+        done
+    done
+    {
+        echo "{"
+        last=$((${#entries[@]} - 1))
+        for i in "${!entries[@]}"; do
+            if [[ $i -lt $last ]]; then
+                echo "  ${entries[$i]},"
+            else
+                echo "  ${entries[$i]}"
+            fi
+        done
+        echo "}"
+    } >"$BASELINE.tmp"
+    mv "$BASELINE.tmp" "$BASELINE"
+    echo "perfcheck: wrote $BASELINE"
+    exit 0
+fi
+
+if [[ ! -f $BASELINE ]]; then
+    echo "perfcheck: no $BASELINE - record one with ./bench/perfcheck.sh --update" >&2
+    exit 2
+fi
+
+failed=0
+
+# check <key> <measured> <higher|lower is better> <tolerance kind>
+check() {
+    local key=$1 measured=$2 better=$3 kind=$4
+    local base tolerance verdict
+    base=$(baseline_value "$key")
+    if [[ -z "$base" ]]; then
+        return
+    fi
+    tolerance=${PERFCHECK_TOLERANCE:-$(baseline_value "tolerance.$kind")}
+    verdict=$(awk -v m="$measured" -v b="$base" -v t="$tolerance" -v better="$better" 'BEGIN {
+        if (better == "higher") bad = m < b * (1 - t); else bad = m > b * (1 + t);
+        change = b != 0 ? 100 * (m - b) / b : 0;
+        printf "%s %+.1f%%", bad ? "FAIL" : "ok", change
+    }')
+    printf "  %-24s %12s  baseline %12s  %s (tolerance %s)\n" "$key" "$measured" "$base" "$verdict" "$tolerance"
+    if [[ $verdict == FAIL* ]]; then
+        failed=1
+    fi
+}
+
+echo "== compared with $BASELINE"
+for scenario in "${SCENARIOS[@]}"; do
+    IFS='|' read -r name _ metrics <<<"$scenario"
+    for metric in $metrics; do
+        case $metric in
+            msgs_per_sec) check "$name.$metric" "${MEASURED[$name.$metric]}" higher throughput ;;
+            p99_us) check "$name.$metric" "${MEASURED[$name.$metric]}" lower latency ;;
+            peak_rss_kb) check "$name.$metric" "${MEASURED[$name.$metric]}" lower memory ;;
+        esac
+    done
+done
+
+if [[ $failed -ne 0 ]]; then
+    echo "perfcheck: regression beyond tolerance" >&2
+    exit 1
+fi
+echo "perfcheck: ok"
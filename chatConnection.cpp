@@ -0,0 +1,524 @@
+#include "chatConnection.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// ============================================================================
+// CHAT CONNECTION - Connect, read, write, reconnect
+// ============================================================================
+
+using boost::asio::ip::tcp;
+
+std::shared_ptr<ChatConnection> ChatConnection::create(boost::asio::io_context& io, const std::string& host,
+                                                       const std::string& port, Handlers handlers) {
+    return create(io, host, port, std::move(handlers), Options());
+}
+
+std::shared_ptr<ChatConnection> ChatConnection::create(boost::asio::io_context& io, const std::string& host,
+                                                       const std::string& port, Handlers handlers,
+                                                       Options options) {
+    return std::shared_ptr<ChatConnection>(
+        new ChatConnection(io, host, port, std::move(handlers), std::move(options)));
+}
+
+ChatConnection::ChatConnection(boost::asio::io_context& io, const std::string& host, const std::string& port,
+                               Handlers handlers, Options options)
+    : io(io), socket_(io), resolver(io), reconnectTimer(io), host(host), port(port),
+      handlers(std::move(handlers)), options(std::move(options)), inbox(inboxBytes) {
+    if (!this->options.historyFile.empty()) {
+        // Picking up where the last run left off: its RESUME is my first.
+        history = std::make_unique<HistoryCache>(this->options.historyFile);
+        epoch = history->epoch();
+        lastSeq = history->lastSeq();
+    }
+}
+
+Message ChatConnection::resumeFrame() const {
+    // Bare "RESUME" on the first connect just says "I understand seqs".
+    return epoch != 0 ? Message::control("RESUME", std::to_string(epoch) + " " + std::to_string(lastSeq))
+                      : Message::control("RESUME");
+}
+
+// ----------------------------------------------------------------------------
+// Connecting
+// ----------------------------------------------------------------------------
+
+void ChatConnection::connectNow() {
+    if (isLocal()) {
+        socket_.connect(boost::asio::local::stream_protocol::endpoint(host.substr(5)));
+    } else {
+        /*
+         * The socket is protocol-generic (so it can also be a Unix socket),
+         * which boost::asio::connect() can't pair with tcp resolver
+         * results. Same try-each-endpoint loop, by hand.
+         */
+        boost::system::error_code ec = boost::asio::error::host_not_found;
+        for (const auto& entry : resolver.resolve(host, port)) {
+            socket_.close();
+            socket_.connect(entry.endpoint(), ec);
+            if (!ec) {
+                break;
+            }
+        }
+        if (ec) {
+            throw boost::system::system_error(ec);
+        }
+    }
+
+    // First frame, before the server joins me to the room.
+    Message resume = resumeFrame();
+    boost::asio::write(socket_, boost::asio::buffer(resume.data, Message::header + resume.getBodyLength()));
+    if (options.creditWindow != 0) {
+        noDelay();
+        Message credit = Message::control("CREDIT", std::to_string(options.creditWindow));
+        boost::asio::write(socket_, boost::asio::buffer(credit.data, Message::header + credit.getBodyLength()));
+    }
+    connected = true;
+    everConnected = true;
+}
+
+void ChatConnection::start() {
+    boost::asio::post(io, [self = shared_from_this()]() {
+        if (self->closed) {
+            return;
+        }
+        if (self->history && !self->historyShown) {
+            // Before anything from the server: the delta it replays follows these.
+            self->historyShown = true;
+            for (const HistoryCache::Entry& entry : self->history->entries()) {
+                if (self->handlers.message) {
+                    self->handlers.message(entry.body);
+                }
+            }
+        }
+        if (self->connected) {
+            self->startReceiving();  // connectNow() already did the rest
+            if (!self->writing) {
+                self->writeQueued();
+            }
+        } else {
+            self->resolve();
+        }
+    });
+}
+
+void ChatConnection::resolve() {
+    /*
+     * Asynchronous even for reconnects: the io_context is shared with every
+     * other connection, and a slow DNS answer mustn't stall them all.
+     */
+    if (isLocal()) {
+        auto candidates = std::make_shared<std::vector<Endpoint>>();
+        candidates->emplace_back(boost::asio::local::stream_protocol::endpoint(host.substr(5)));
+        tryEndpoint(candidates, 0);
+        return;
+    }
+    resolver.async_resolve(host, port,
+        [self = shared_from_this()](boost::system::error_code ec, tcp::resolver::results_type results) {
+            if (self->closed) {
+                return;
+            }
+            auto candidates = std::make_shared<std::vector<Endpoint>>();
+            for (const auto& entry : results) {
+                candidates->emplace_back(entry.endpoint());
+            }
+            if (ec) {
+                self->giveUpOrRetry(ec.message());
+                return;
+            }
+            self->tryEndpoint(candidates, 0);
+        });
+}
+
+void ChatConnection::tryEndpoint(std::shared_ptr<std::vector<Endpoint>> candidates, size_t index) {
+    if (index >= candidates->size()) {
+        giveUpOrRetry(lastConnectError.empty() ? "no address to connect to" : lastConnectError);
+        return;
+    }
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    socket_.async_connect((*candidates)[index],
+        [self = shared_from_this(), candidates, index](boost::system::error_code ec) {
+            if (self->closed) {
+                return;
+            }
+            if (ec) {
+                self->lastConnectError = ec.message();
+                self->tryEndpoint(candidates, index + 1);
+                return;
+            }
+            self->established();
+        });
+}
+
+void ChatConnection::established() {
+    connected = true;
+    everConnected = true;
+    reconnectAttempt = 0;
+    lastConnectError.clear();
+
+    /*
+     * RESUME has to be the first frame, ahead of anything sent while I was
+     * away. connectionLost() already settled the old socket's write and
+     * emptied `urgent`, whenever that write's handler gets to run, so
+     * nothing is being written. Credit starts over with the new connection.
+     */
+    inboxBegin = inboxEnd = 0;  // a partial frame from the old socket is useless
+    urgent.push_back(resumeFrame());
+    sendLimit = UINT64_MAX;
+    sendUsed = 0;
+    ungranted = 0;
+    if (options.creditWindow != 0) {
+        noDelay();
+        urgent.push_back(Message::control("CREDIT", std::to_string(options.creditWindow)));
+    }
+    startReceiving();
+    if (!writing) {
+        writeQueued();
+    }
+    if (handlers.connected) {
+        handlers.connected();
+    }
+}
+
+void ChatConnection::connectionLost(const std::string& why) {
+    if (!connected || closed) {
+        return;
+    }
+    connected = false;
+    ++generation;
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    expectSeq = 0;  // unknown until the next EPOCH
+
+    /*
+     * The write in flight, if any, died with the socket. Settle it here,
+     * not in its handler, which may run before or after the reconnect (and
+     * skips its bookkeeping once the generation has moved on). The close
+     * cancelled it, so its buffers are no longer touched. Its frames are
+     * dropped: some may have arrived, and resending them could duplicate
+     * them. PONGs and grants were for the old connection.
+     */
+    size_t settled = 0;
+    if (writing) {
+        outbound.erase(outbound.begin(), outbound.begin() + writingCount);
+        settled = writingBytes;
+        pendingBytes.fetch_sub(settled, std::memory_order_acq_rel);
+        writing = false;
+    }
+    urgent.clear();
+    if (settled != 0 && handlers.drained) {
+        handlers.drained();
+    }
+    if (!options.reconnect) {
+        giveUp(why);
+        return;
+    }
+    if (handlers.disconnected) {
+        handlers.disconnected(why, true);
+    }
+    scheduleReconnect();
+}
+
+void ChatConnection::giveUpOrRetry(const std::string& why) {
+    if (everConnected || options.retryFirstConnect) {
+        scheduleReconnect();
+    } else {
+        giveUp(why);
+    }
+}
+
+void ChatConnection::giveUp(const std::string& why) {
+    closed = true;
+    connected = false;
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    if (handlers.disconnected) {
+        handlers.disconnected(why, false);
+    }
+}
+
+void ChatConnection::scheduleReconnect() {
+    /*
+     * Exponential backoff with "equal jitter" - half the delay fixed, half
+     * random - so a thousand clients dropped by one restart don't all come
+     * back in the same millisecond, yet none of them retries absurdly early.
+     */
+    long ceiling = options.maxBackoff.count();
+    if (reconnectAttempt < 16) {
+        ceiling = std::min(ceiling, long(options.minBackoff.count()) << reconnectAttempt);
+    }
+    ++reconnectAttempt;
+    std::uniform_int_distribution<long> pick(ceiling / 2, ceiling);
+    reconnectTimer.expires_after(std::chrono::milliseconds(pick(jitter)));
+    reconnectTimer.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+        if (!ec && !self->closed) {
+            self->resolve();
+        }
+    });
+}
+
+void ChatConnection::close() {
+    closed = true;
+    boost::asio::post(io, [self = shared_from_this()]() {
+        self->connected = false;
+        boost::system::error_code ignored;
+        self->reconnectTimer.cancel();
+        self->resolver.cancel();
+        self->socket_.close(ignored);  // cancels the read and any write
+    });
+}
+
+// ----------------------------------------------------------------------------
+// Reading
+// ----------------------------------------------------------------------------
+
+void ChatConnection::startReceiving() {
+    /*
+     * One read_some per socket-buffer's worth instead of two reads (header,
+     * then body) per frame: in a busy room that's dozens of frames per
+     * syscall. Whatever partial frame is left over moves to the front.
+     */
+    if (inboxBegin > 0) {
+        std::memmove(inbox.data(), inbox.data() + inboxBegin, inboxEnd - inboxBegin);
+        inboxEnd -= inboxBegin;
+        inboxBegin = 0;
+    }
+    socket_.async_read_some(boost::asio::buffer(inbox.data() + inboxEnd, inbox.size() - inboxEnd),
+        [self = shared_from_this(), current = generation](boost::system::error_code ec, std::size_t got) {
+            if (current != self->generation || self->closed) {
+                return;  // from a connection that's already gone
+            }
+            if (ec) {
+                self->connectionLost(ec.message());
+                return;
+            }
+            self->inboxEnd += got;
+            bool more = self->decodeInbox(current);
+            if (self->history && !self->history->flush()) {
+                self->history.reset();  // one write per read, however many frames
+            }
+            if (more) {
+                self->startReceiving();
+            }
+        });
+}
+
+bool ChatConnection::decodeInbox(uint64_t current) {
+    // Every complete frame in the inbox, decoded in place. False = stop reading.
+    while (inboxEnd - inboxBegin >= Message::header) {
+        const char* frame = inbox.data() + inboxBegin;
+        std::memcpy(readMessage.data, frame, Message::header);
+        if (!readMessage.decodeHeader()) {
+            // No way to find the next frame boundary; start over.
+            connectionLost("invalid frame header");
+            return false;
+        }
+        size_t length = readMessage.getBodyLength();
+        if (inboxEnd - inboxBegin < Message::header + length) {
+            break;  // the rest of it is still on the way
+        }
+        inboxBegin += Message::header + length;
+
+        if (length > 0 && frame[Message::header] == Message::controlMarker) {
+            std::memcpy(readMessage.data + Message::header, frame + Message::header, length);
+            handleControl();
+        } else {
+            if (isNew()) {
+                std::string_view body(frame + Message::header, length);
+                if (history && expectSeq != 0) {
+                    history->append(lastSeq, body);
+                }
+                if (handlers.message) {
+                    // Straight out of the inbox: no copy, no allocation per frame.
+                    handlers.message(body);
+                }
+            }
+            // Consumed (duplicates too - they used the server's credit).
+            if (options.creditWindow != 0 && ++ungranted >= std::max<size_t>(1, options.creditWindow / 2)) {
+                grantCredit(ungranted);
+                ungranted = 0;
+            }
+        }
+        if (current != generation || closed) {
+            return false;  // a handler closed us, or a PONG write failed
+        }
+    }
+    return true;
+}
+
+void ChatConnection::handleControl() {
+    // Everything but the resume bookkeeping and heartbeats is the caller's.
+    std::string_view verb = readMessage.controlVerb();
+    if (verb == "EPOCH") {
+        uint64_t announced = std::strtoull(std::string(readMessage.controlArgs()).c_str(), nullptr, 10);
+        bool restarted = epoch != 0 && announced != epoch;
+        if (restarted) {
+            lastSeq = 0;
+        }
+        if (history && history->epoch() != announced && !history->reset(announced)) {
+            history.reset();  // restarted, or nothing cached yet; a full disk ends the caching
+        }
+        epoch = announced;
+        expectSeq = 1;
+        if (restarted && handlers.serverRestarted) {
+            handlers.serverRestarted();
+        }
+    } else if (verb == "SEQ") {
+        expectSeq = std::strtoull(std::string(readMessage.controlArgs()).c_str(), nullptr, 10);
+    } else if (verb == "PING") {
+        // Answered here so an idle reader stays connected; never refused.
+        urgent.push_back(Message::control("PONG", std::string(readMessage.controlArgs())));
+        if (!writing) {
+            writeQueued();
+        }
+    } else if (verb == "CREDIT") {
+        uint64_t frames = std::strtoull(std::string(readMessage.controlArgs()).c_str(), nullptr, 10);
+        sendLimit = sendLimit == UINT64_MAX ? frames : sendLimit + frames;
+        if (!writing) {
+            writeQueued();  // whatever was held for it
+        }
+    } else if (handlers.control) {
+        handlers.control(verb, readMessage.controlArgs());
+    }
+}
+
+void ChatConnection::noDelay() {
+    /*
+     * The server waits on my grants. Nagle would hold a CREDIT until the
+     * previous one is ACKed, and the server delays that ACK up to 40ms -
+     * a window per 40ms is all a flow-controlled stream would get.
+     */
+    if (!isLocal()) {
+        boost::system::error_code ignored;
+        socket_.set_option(tcp::no_delay(true), ignored);
+    }
+}
+
+void ChatConnection::grantCredit(uint64_t frames) {
+    urgent.push_back(Message::control("CREDIT", std::to_string(frames)));
+    if (!writing) {
+        writeQueued();
+    }
+}
+
+bool ChatConnection::isNew() {
+    /*
+     * Seq of the chat frame just read. Anything at or below lastSeq was
+     * already delivered - only possible if my RESUME reached the server too
+     * late and it replayed everything.
+     */
+    if (expectSeq == 0) {
+        return true;  // old server: no numbering, nothing to dedupe
+    }
+    uint64_t seq = expectSeq++;
+    if (seq <= lastSeq) {
+        return false;
+    }
+    lastSeq = seq;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Writing
+// ----------------------------------------------------------------------------
+
+bool ChatConnection::send(const Message& msg) {
+    std::vector<Message> frames;
+    frames.push_back(msg);
+    return send(std::move(frames));
+}
+
+bool ChatConnection::send(std::vector<Message>&& batch) {
+    if (batch.empty()) {
+        return !closed;
+    }
+    if (closed || pendingBytes.load(std::memory_order_acquire) >= options.outboundLimit) {
+        return false;
+    }
+    size_t bytes = 0;
+    for (const Message& msg : batch) {
+        bytes += Message::header + msg.getBodyLength();
+    }
+    pendingBytes.fetch_add(bytes, std::memory_order_acq_rel);
+    auto frames = std::make_shared<std::vector<Message>>(std::move(batch));
+    batch.clear();
+    boost::asio::post(io, [self = shared_from_this(), frames]() { self->enqueue(std::move(*frames)); });
+    return true;
+}
+
+void ChatConnection::enqueue(std::vector<Message>&& frames) {
+    if (closed) {
+        return;
+    }
+    outbound.insert(outbound.end(), frames.begin(), frames.end());
+    if (!writing && connected) {
+        writeQueued();  // while disconnected it waits for established()
+    }
+}
+
+void ChatConnection::writeQueued() {
+    /*
+     * Everything queued (up to maxGather frames) goes out as one gathered
+     * write, urgent frames first. deque::push_back never moves existing
+     * elements, so the buffers stay valid while new frames arrive. Chat
+     * stops at the server's credit; its next CREDIT calls me again.
+     */
+    gather.clear();
+    size_t controls = std::min(urgent.size(), maxGather);
+    for (size_t i = 0; i < controls; ++i) {
+        gather.push_back(boost::asio::buffer(urgent[i].data, Message::header + urgent[i].getBodyLength()));
+    }
+    size_t count = 0;
+    size_t bytes = 0;
+    while (count < outbound.size() && controls + count < maxGather) {
+        const Message& msg = outbound[count];
+        if (!msg.isControl()) {
+            if (sendUsed >= sendLimit) {
+                break;
+            }
+            ++sendUsed;
+        }
+        gather.push_back(boost::asio::buffer(msg.data, Message::header + msg.getBodyLength()));
+        bytes += Message::header + msg.getBodyLength();
+        ++count;
+    }
+    if (gather.empty()) {
+        return;
+    }
+    writing = true;
+    writingCount = count;
+    writingBytes = bytes;
+    boost::asio::async_write(socket_, gather,
+        [self = shared_from_this(), controls, count, bytes, current = generation](boost::system::error_code ec,
+                                                                                 std::size_t) {
+            if (current != self->generation) {
+                return;  // connectionLost() settled this batch; the queues are the new connection's
+            }
+            self->writing = false;
+            /*
+             * Success or not, this batch is done with: a failed write may
+             * have partly arrived, and resending could duplicate it. What's
+             * still queued behind it waits for the reconnect.
+             */
+            self->urgent.erase(self->urgent.begin(), self->urgent.begin() + controls);
+            self->outbound.erase(self->outbound.begin(), self->outbound.begin() + count);
+            self->pendingBytes.fetch_sub(bytes, std::memory_order_acq_rel);
+            if (self->closed) {
+                return;
+            }
+            if (self->handlers.drained) {
+                self->handlers.drained();
+            }
+            if (ec) {
+                if (ec != boost::asio::error::operation_aborted) {
+                    self->connectionLost(ec.message() + " (" + std::to_string(count) +
+                                         " message(s) may not have arrived)");
+                }
+                return;
+            }
+            if (self->connected && !self->writing) {
+                self->writeQueued();
+            }
+        });
+}
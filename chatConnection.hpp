@@ -0,0 +1,217 @@
+#include <utility>  // must precede asio: boost 1.74 awaitable.hpp uses std::exchange
+#include <boost/asio.hpp>
+#include "historyCache.hpp"
+#include "message.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef CHAT_CONNECTION_HPP
+#define CHAT_CONNECTION_HPP
+
+/*
+ * ============================================================================
+ * CHAT CONNECTION - One client connection, no thread or terminal attached
+ * ============================================================================
+ *
+ * clientApp used to be a single class that owned an io_context, a thread,
+ * stdin and stdout. Fine for one human; useless for an integration service
+ * that wants a few hundred bot identities in one process - that would be a
+ * few hundred threads each blocked in epoll_wait.
+ *
+ * This is the network half of the client on its own, built as
+ * libchatclient.a. A ChatConnection lives on an io_context it is given and
+ * never blocks it, so any number of them can share one:
+ *
+ *   boost::asio::io_context io;
+ *   std::vector<std::shared_ptr<ChatConnection>> bots;
+ *   for (int i = 0; i < 300; ++i) {
+ *       ChatConnection::Handlers handlers;
+ *       handlers.message = [i](std::string_view body) { ... };
+ *       bots.push_back(ChatConnection::create(io, "chat.internal", "8080", handlers));
+ *       bots.back()->start();
+ *   }
+ *   io.run();
+ *
+ * What it does for the caller:
+ *   - connects (TCP or "unix:<path>"), reads frames, answers PINGs
+ *   - tracks EPOCH/SEQ and drops chat frames it has already delivered
+ *   - pipelines sends: one gathered async_write in flight, the rest queued
+ *   - reconnects with jittered exponential backoff and RESUMEs, so the
+ *     server replays only what was missed (see Room::join)
+ *   - flow control, both ways (CREDIT, see message.hpp): holds chat frames
+ *     while the server has granted no room for them, and with creditWindow
+ *     set only lets the server run that many frames ahead of message()
+ *   - with historyFile set, remembers what it delivered across runs (see
+ *     historyCache.hpp): start() hands the cached frames to message()
+ *     first, and the first RESUME asks only for what came after them
+ *
+ * Threading follows the server's IoPool rule: a connection's handlers run
+ * on whichever thread runs its io_context, so run each io_context on one
+ * thread (use several io_contexts for more cores). Callbacks arrive on that
+ * thread. send(), close() and the accessors are safe from anywhere.
+ *
+ * Errors never throw out of the io_context; they arrive as disconnected().
+ * ============================================================================
+ */
+
+class ChatConnection : public std::enable_shared_from_this<ChatConnection> {
+public:
+    using Socket = boost::asio::generic::stream_protocol::socket;
+
+    // All optional. Called on the io_context's thread.
+    struct Handlers {
+        std::function<void()> connected;                    // up after start() or a reconnect
+        std::function<void(std::string_view body)> message; // a chat frame, valid during the call
+        std::function<void(const std::string& why, bool retrying)> disconnected;
+        std::function<void()> drained;                      // a write finished; queuedBytes() went down
+        std::function<void()> serverRestarted;              // new epoch: history starts over
+        std::function<void(std::string_view verb, std::string_view args)> control;  // the rest (PONG, PROBE)
+    };
+
+    struct Options {
+        bool reconnect = true;           // after an established connection drops
+        bool retryFirstConnect = false;  // start(): keep trying an unreachable server
+        size_t outboundLimit = 1 << 20;  // send() refuses while this many bytes wait
+        std::chrono::milliseconds minBackoff{250};
+        std::chrono::milliseconds maxBackoff{30000};
+        size_t creditWindow = 0;         // chat frames the server may send ahead; 0 = unlimited
+        std::string historyFile;         // on-disk history cache; "" = none
+    };
+
+    static std::shared_ptr<ChatConnection> create(boost::asio::io_context& io, const std::string& host,
+                                                  const std::string& port, Handlers handlers);
+    // Throws if options.historyFile can't be opened or another client holds it.
+    static std::shared_ptr<ChatConnection> create(boost::asio::io_context& io, const std::string& host,
+                                                  const std::string& port, Handlers handlers,
+                                                  Options options);
+
+    /*
+     * Blocking connect + RESUME, throws on failure. Optional: for callers
+     * that want to fail fast, or to talk on socket() synchronously (the
+     * shared-memory upgrade) before start(). Not from the io thread.
+     */
+    void connectNow();
+    Socket& socket() { return socket_; }
+
+    // Begin reading (connecting first unless connectNow() did). Any thread.
+    void start();
+
+    /*
+     * Queue frames for sending. Never blocks; false when the connection is
+     * closed or more than outboundLimit bytes are already waiting - wait
+     * for drained() and try again. Frames sent while reconnecting go out
+     * after the RESUME.
+     */
+    bool send(const Message& msg);
+    bool send(std::vector<Message>&& batch);
+
+    // Stop for good: no more callbacks, queued frames are dropped. Any thread.
+    void close();
+
+    size_t queuedBytes() const { return pendingBytes.load(std::memory_order_acquire); }
+    bool isConnected() const { return connected.load(std::memory_order_acquire); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+private:
+    using Endpoint = boost::asio::generic::stream_protocol::endpoint;
+
+    ChatConnection(boost::asio::io_context& io, const std::string& host, const std::string& port,
+                   Handlers handlers, Options options);
+
+    bool isLocal() const { return host.rfind("unix:", 0) == 0; }
+    Message resumeFrame() const;
+
+    void resolve();
+    void tryEndpoint(std::shared_ptr<std::vector<Endpoint>> candidates, size_t index);
+    void established();
+    void connectionLost(const std::string& why);
+    void giveUpOrRetry(const std::string& why);
+    void giveUp(const std::string& why);
+    void scheduleReconnect();
+
+    void startReceiving();
+    bool decodeInbox(uint64_t current);
+    void handleControl();
+    bool isNew();
+
+    void enqueue(std::vector<Message>&& frames);
+    void writeQueued();
+
+    boost::asio::io_context& io;
+    Socket socket_;
+    boost::asio::ip::tcp::resolver resolver;
+    boost::asio::steady_timer reconnectTimer;
+    std::string host;
+    std::string port;
+    Handlers handlers;
+    Options options;
+
+    /*
+     * Bytes read but not yet decoded, [inboxBegin, inboxEnd). 16 KiB is
+     * thirty-odd full-size frames - plenty per read without costing a bot
+     * farm much per connection. readMessage holds the current header (and
+     * control bodies, for controlVerb()).
+     */
+    static constexpr size_t inboxBytes = 16 * 1024;
+    std::vector<char> inbox;
+    size_t inboxBegin = 0;
+    size_t inboxEnd = 0;
+    Message readMessage;
+
+    /*
+     * Outbound queues (io thread only): one gathered async_write in flight.
+     * `urgent` is my own protocol traffic - RESUME, CREDIT, PONG - which
+     * goes out ahead of chat and never waits for credit, or a chat frame
+     * held for credit could keep the CREDIT that releases it from leaving.
+     */
+    std::deque<Message> outbound;
+    std::deque<Message> urgent;
+    bool writing = false;
+    size_t writingCount = 0;  // outbound frames in that write, for connectionLost()
+    size_t writingBytes = 0;
+    std::vector<boost::asio::const_buffer> gather;
+    static constexpr size_t maxGather = 256;  // well under IOV_MAX
+
+    // Bytes accepted by send() and not yet written - the backpressure signal.
+    std::atomic<size_t> pendingBytes{0};
+
+    /*
+     * Flow control, per connection (io thread). sendLimit is what the
+     * server has granted in total, UINT64_MAX until it grants anything;
+     * ungranted counts chat frames read since I last gave credit back.
+     */
+    void grantCredit(uint64_t frames);
+    void noDelay();
+    uint64_t sendLimit = UINT64_MAX;
+    uint64_t sendUsed = 0;
+    size_t ungranted = 0;
+
+    /*
+     * Resume state (io thread). The server tells me its epoch on join and
+     * sends "SEQ <n>" whenever the numbering would skip; otherwise each chat
+     * frame is the previous one + 1, so lastSeq is always the seq of the
+     * last frame handed to message().
+     */
+    uint64_t epoch = 0;       // 0 = server doesn't number frames
+    uint64_t expectSeq = 0;   // seq of the next chat frame
+    uint64_t lastSeq = 0;     // highest seq delivered
+    std::unique_ptr<HistoryCache> history;  // seeds epoch/lastSeq; null = no cache
+    bool historyShown = false;
+    uint64_t generation = 0;  // bumped per connection; stale handlers bail
+    unsigned reconnectAttempt = 0;
+    bool everConnected = false;
+    std::string lastConnectError;
+    std::mt19937 jitter{std::random_device{}()};
+
+    std::atomic<bool> connected{false};
+    std::atomic<bool> closed{false};
+};
+
+#endif // CHAT_CONNECTION_HPP
@@ -1,5 +1,16 @@
 #include "chatRoom.hpp"
-#include <iostream>
+#include "egress.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+#include "muxChannel.hpp"
+#include "shmSession.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sys/socket.h>
 
 /*
  * ============================================================================
@@ -79,7 +90,19 @@
 // ROOM IMPLEMENTATION - The Mediator Pattern in Action
 // ============================================================================
 
-void Room::join(ParticipantPtr participant) {
+Room::Room(const std::string& name)
+    : fanoutLatency(MetricsRegistry::global().latency(
+          "chat_room_fanout_latency_seconds",
+          "Sender's read completing to each recipient's write completing, per room.",
+          "room=\"" + name + "\"")),
+      epoch_((uint64_t(std::random_device{}()) << 32 | std::random_device{}()) | 1) {
+    memory.setLabel(name);
+    memory.buffers.store(sizeof(Room), std::memory_order_relaxed);
+}
+
+void Room::join(ParticipantPtr participant, uint64_t resumeAfter) {
+    std::lock_guard<std::mutex> lock(mutex);
+
     /*
      *  ROOM MEMBERSHIP - The Art of Managing Dynamic Collections
      *
@@ -174,12 +197,28 @@ void Room::join(ParticipantPtr participant) {
      *   3. But those async ops can't modify MessageQueue (different object)
      *   4. Iterator stays valid throughout loop
      */
-    for (const auto& msg : MessageQueue) {
-        participant->deliver(msg);
+    /*
+     * Seqs only grow along MessageQueue, so a resuming client's delta is a
+     * suffix: binary-search its start rather than test every frame. A client
+     * back from its on-disk cache (historyCache.hpp) usually gets a few
+     * frames or none, and a mass reconnect costs the Room that much less.
+     */
+    auto first = std::partition_point(MessageQueue.begin(), MessageQueue.end(),
+                                      [resumeAfter](const FramePtr& frame) { return frame->seq <= resumeAfter; });
+    for (auto it = first; it != MessageQueue.end(); ++it) {
+        participant->deliver(makeReplay(**it));  // untimed: not a fan-out
     }
 }
 
+void Room::replace(ParticipantPtr from, ParticipantPtr to) {
+    std::lock_guard<std::mutex> lock(mutex);
+    participants.erase(from);
+    participants.insert(to);
+}
+
 void Room::leave(ParticipantPtr participant) {
+    std::lock_guard<std::mutex> lock(mutex);
+
     /*
      *  DEPARTURE MANAGEMENT - Handling the Chaos of Network Disconnections
      *
@@ -263,7 +302,10 @@ void Room::leave(ParticipantPtr participant) {
     participants.erase(participant);
 }
 
-void Room::deliver(ParticipantPtr sender, const Message& msg) {
+void Room::deliver(ParticipantPtr sender, const FramePtr& frame) {
+    uint64_t traceStart = frame->traceId ? Tracer::now() : 0;
+    std::lock_guard<std::mutex> lock(mutex);
+
     /*
      *  MESSAGE BROADCASTING - The Heart of Real-Time Communication
      *
@@ -319,7 +361,9 @@ void Room::deliver(ParticipantPtr sender, const Message& msg) {
      * │  Decision: Simplicity and reliability > perfect history          │
      * └─────────────────────────────────────────────────────────────────────┘
      */
-    MessageQueue.push_back(msg);
+    frame->seq = ++lastSeq;  // see frame.hpp: still only the sender's reference
+    MessageQueue.push_back(frame);
+    memory.history.fetch_add(frameFootprint, std::memory_order_relaxed);
 
     /*
      *  PHASE 2: MEMORY MANAGEMENT
@@ -362,6 +406,7 @@ void Room::deliver(ParticipantPtr sender, const Message& msg) {
      */
     if (MessageQueue.size() > 50) {
         MessageQueue.pop_front();  // O(1) sliding window operation
+        memory.history.fetch_sub(frameFootprint, std::memory_order_relaxed);
     }
 
     /*
@@ -391,32 +436,137 @@ void Room::deliver(ParticipantPtr sender, const Message& msg) {
      *
      *  ASYNC BROADCAST SAFETY:
      *
-     * Key insight: This loop might trigger many async operations
-     * (each participant->deliver() could start async_write), but
-     * it's safe because:
-     *
-     *   1. We iterate over a snapshot of participants
-     *   2. Each deliver() call is independent
-     *   3. If a participant disconnects during iteration,
-     *      their async operations complete safely
-     *   4. Room state remains consistent
-     *
-     * The magic of async: starting many operations is fast,
-     * even if completing them takes time.
+     * This loop runs with the room mutex held, over the live participant
+     * set, not a copy. That is safe and cheap because deliver() only
+     * queues:
+     *
+     *   1. Each deliver() pushes onto the recipient's lock-free inbox and,
+     *      at most, post()s the start of its write. No syscall, and
+     *      nothing runs inline that could re-enter the Room (a failed
+     *      write's close() -> leave() would deadlock on this mutex).
+     *   2. Holding the lock for the push is what keeps every recipient's
+     *      frames in seq order. Copying the set and delivering after
+     *      unlocking would let two workers' broadcasts interleave, and
+     *      clients drop a frame whose seq goes backwards (see
+     *      ChatConnection::isNew()).
+     *   3. A participant that disconnects meanwhile just has a frame
+     *      queued that its close() frees.
      */
+    size_t recipients = 0;
     for (auto participant : participants) {
         if (participant != sender) {
-            participant->deliver(msg);  // Might start async_write operation
+            participant->deliver(frame);  // Might start async_write operation
+            ++recipients;
+        }
+    }
+
+    ServerMetrics& metrics = ServerMetrics::get();
+    metrics.broadcasts.inc();
+    metrics.deliveries.inc(recipients);
+    if (frame->traceId) {
+        Tracer::span("Room::deliver", frame->traceId, traceStart, Tracer::now(), "recipients", recipients);
+    }
+}
+
+void Room::setBacklogged(bool on) {
+    ServerMetrics::get().flowBacklogged.add(on ? 1 : -1);
+    if (on) {
+        backlogged.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+    if (backlogged.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;  // someone else is still behind
+    }
+    std::vector<std::function<void()>> resume;
+    {
+        std::lock_guard<std::mutex> lock(clearMutex);
+        resume.swap(waitingForClear);
+    }
+    for (auto& waiter : resume) {
+        waiter();
+    }
+}
+
+void Room::whenClear(std::function<void()> resume) {
+    {
+        std::lock_guard<std::mutex> lock(clearMutex);
+        if (congested()) {
+            waitingForClear.push_back(std::move(resume));
+            return;
         }
     }
+    resume();  // cleared while I was deciding to wait
+}
+
+void Room::recordFanout(const Frame& frame, Frame::Clock::time_point written) {
+    uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(written - frame.ingress).count();
+    fanoutLatency.record(nanos);
+    ServerMetrics::get().fanoutLatency.record(nanos);
 }
 
 // ============================================================================
 // SESSION IMPLEMENTATION - Where Async Programming Gets Mind-Bending
 // ============================================================================
 
-Session::Session(tcp::socket socket, Room& room)
-    : clientSocket(std::move(socket)), room(room) {
+static uint64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// PROBE arguments are echoed back; anything longer isn't a probe.
+static const size_t probeArgsLimit = 256;
+
+static Message stampProbe(const Message& queued) {
+    // "PROBE <args> @<read ns>" → "PROBE <args> <queue ns>"
+    std::string_view body = queued.controlArgs();
+    size_t at = body.rfind('@');  // mine is last; the client's args may hold more
+    uint64_t readAt = std::strtoull(std::string(body.substr(at + 1)).c_str(), nullptr, 10);
+    uint64_t now = steadyNanos();
+    std::string args(body.substr(0, at));  // client's args plus a space, or empty
+    return Message::control("PROBE", args + std::to_string(now > readAt ? now - readAt : 0));
+}
+
+/*
+ * A CH marker's id list has to fit one frame body after "\x01CH ". A MUX run
+ * (one broadcast for several of my channels) ends where the next id would
+ * overflow it - collectOutbound() and flushBatch() both cut runs here, so
+ * each copy flushBatch() writes was counted (and charged credit) once.
+ */
+static const size_t channelListLimit = Message::maxBytes - 4;
+
+static size_t channelIdChars(uint32_t id) {
+    size_t chars = 1;
+    while (id >= 10) {
+        id /= 10;
+        ++chars;
+    }
+    return chars;
+}
+
+static bool channelListFits(size_t listChars, uint32_t next) {
+    return listChars + 1 + channelIdChars(next) <= channelListLimit;
+}
+
+// "203.0.113.7:51234" for TCP, "unix" for a local client - for /top.
+static std::string describePeer(const StreamSocket& socket) {
+    boost::system::error_code ec;
+    auto peer = socket.remote_endpoint(ec);
+    if (ec) {
+        return "?";
+    }
+    if (peer.protocol().family() == AF_UNIX) {
+        return "unix";
+    }
+    tcp::endpoint address;
+    size_t length = std::min<size_t>(peer.size(), address.capacity());
+    std::memcpy(address.data(), peer.data(), length);
+    address.resize(length);
+    return address.address().to_string() + ":" + std::to_string(address.port());
+}
+
+Session::Session(StreamSocket socket, Room& room, const SessionOptions& options)
+    : clientSocket(std::move(socket)), room(room),
+      wheel(boost::asio::use_service<TimingWheel>(clientSocket.get_executor().context())) {
     /*
      *  CONSTRUCTOR PHILOSOPHY - The Async Object Creation Dilemma
      *
@@ -475,10 +625,68 @@ Session::Session(tcp::socket socket, Room& room)
      *
      *  INSIGHT: Constructor sets up ownership relationships
      *            but doesn't start any async operations
+     *
+     * The wheel lookup is safe from the accept thread (use_service locks);
+     * nothing is scheduled on it until start() runs on my own worker.
      */
+    ServerMetrics::get().sessionsActive.add(1);
+
+    auto ticksFor = [this](std::chrono::milliseconds d) -> TimingWheel::Tick {
+        return d.count() > 0 ? wheel.toTicks(d) : 0;
+    };
+    heartbeatTicks = ticksFor(options.heartbeat);
+    idleTicks = ticksFor(options.idleTimeout);
+    readTicks = ticksFor(options.readTimeout);
+    writeTicks = ticksFor(options.writeTimeout);
+    flowStallTicks = std::max<TimingWheel::Tick>(1, ticksFor(options.flowStall));
+
+    boost::system::error_code ec;
+    auto local = clientSocket.local_endpoint(ec);
+    localTransport = !ec && local.protocol().family() == AF_UNIX;
+    shmRingBytes = options.shmRingBytes;
+    maxChannels = options.muxChannels;
+    flowWindow = options.flowWindow;
+    memory.setLabel(describePeer(clientSocket));
+    accountBuffers();
+
+    coalesceWindow = options.coalesceWindow;
+    coalesceBytes = options.coalesceBytes;
+    corkEnabled = options.cork;
+    if (coalesceWindow.count() > 0) {
+        coalesceTimer.emplace(clientSocket.get_executor());
+    }
+    if ((corkEnabled || flowWindow != 0) && !localTransport) {
+        /*
+         * With corking in charge of batching, Nagle only adds delay to the
+         * uncorked (shallow queue) case. Turn it off. Same with flow control:
+         * a CREDIT held back by Nagle stalls the client's sends.
+         */
+        boost::system::error_code ignored;
+        clientSocket.set_option(tcp::no_delay(true), ignored);
+    }
 }
 
-void Session::deliver(const Message& msg) {
+Session::~Session() {
+    /*
+     * The inbox owns whatever nobody got around to writing (client vanished
+     * with frames still queued). The last shared_ptr is gone, so no producer
+     * can be pushing any more - safe to drain from whichever thread this is.
+     */
+    int64_t abandoned = static_cast<int64_t>(inFlight.size() + heldForCredit.size());
+    while (MpscNode* node = outboundInbox.pop()) {
+        delete static_cast<OutboundNode*>(node);
+        ++abandoned;
+    }
+    ServerMetrics& metrics = ServerMetrics::get();
+    metrics.outboundQueued.add(-abandoned);
+    metrics.sessionsActive.add(-1);
+}
+
+void Session::deliver(const FramePtr& frame) {
+    deliverOnChannel(0, frame);
+}
+
+void Session::deliverOnChannel(uint32_t channel, const FramePtr& frame) {
     /*
      *  MESSAGE DELIVERY - The Async Write Coordination Problem
      *
@@ -542,7 +750,17 @@ void Session::deliver(const Message& msg) {
      *   callback() → remove completed → idle state
      *   Queue: [] → Writing: none
      */
-    outgoingMessages.push_back(msg);
+    OutboundNode* node = new OutboundNode(frame, channel);
+    if (frame->traceId) {
+        node->tracedAt = Tracer::now();
+    }
+    outboundInbox.push(node);
+    ServerMetrics::get().outboundQueued.add(1);
+    memory.queued.fetch_add(queuedFrameBytes, std::memory_order_relaxed);
+    if (flowWindow != 0 && queuedFrames.fetch_add(1, std::memory_order_relaxed) + 1 >= flowWindow &&
+        !backlogged.exchange(true, std::memory_order_acq_rel)) {
+        room.setBacklogged(true);  // see readNext()
+    }
 
     /*
      *  QUEUE LENGTH ANALYSIS - The Write State Detection Pattern
@@ -582,9 +800,31 @@ void Session::deliver(const Message& msg) {
      * Callback: msg_A write completes
      *   outgoingMessages = [msg_B]  (after pop_front)
      *   Queue not empty → start async_write(msg_B)
+     *
+     *  UPDATE - why the flag came back:
+     *
+     * Queue-length detection only works if one thread owns the queue. With
+     * Room::deliver() running on other threads, two producers can push
+     * concurrently and neither sees "size == 1", or both do. So the write
+     * state is an atomic flag after all - but a lock-free one:
+     *
+     *   producer:  push(node);  if (!writeActive.exchange(true)) schedule drain
+     *   consumer:  drain until empty; writeActive = false; re-check inbox
+     *
+     * Exactly one producer wins the exchange and schedules the drain on MY
+     * executor. The consumer's re-check after clearing the flag closes the
+     * window where a push lands between "inbox empty" and "flag cleared".
+     *
+     * post(), never dispatch(). I'm called from Room::deliver() with the
+     * room mutex held. Starting the write inline would put the speculative
+     * send syscall inside that lock, and every other worker delivering to
+     * the room would wait on it. It could also deadlock: a failed write
+     * can close() me, and close() calls room.leave(), which takes the same
+     * mutex. Posting also lets a MUX fan-out queue one frame for all my
+     * channels before the first copy goes out, so they share one batch.
      */
-    if (outgoingMessages.size() == 1) {
-        async_write();  // Begin the write state machine
+    if (!writeActive.exchange(true, std::memory_order_seq_cst)) {
+        boost::asio::post(clientSocket.get_executor(), [self = shared_from_this()]() { self->async_write(); });
     }
 }
 
@@ -661,8 +901,13 @@ void Session::write(Message& msg) {
      *   3. Room needs to identify which Session sent the message
      *   4. shared_ptr ensures this Session stays alive during Room operations
      *   5. Even if client disconnects, Room can safely exclude sender
+     *
+     * The frame's ingress stamp is taken here, straight out of
+     * readMessageBody(): from now until a recipient's write completes is
+     * what Room::recordFanout() measures - room lock, queueing, batching
+     * and the socket write all included.
      */
-    room.deliver(shared_from_this(), msg);
+    room.deliver(shared_from_this(), makeFrame(msg, Frame::Clock::now(), traceId));
 }
 
 void Session::start() {
@@ -735,22 +980,30 @@ void Session::start() {
      */
 
     /*
-     *  PHASE 1: JOIN THE ROOM COMMUNITY
-     *
-     * Why join the room first?
-     *   1. Room.join() delivers message history immediately
-     *   2. async_read() will soon deliver incoming messages
-     *   3. Want history BEFORE new messages for proper ordering
-     *   4. User sees context, then real-time flow
-     *
-     *  SHARED_PTR SAFETY:
-     * shared_from_this() is now safe because:
-     *   - Constructor has completed
-     *   - shared_ptr is fully constructed
-     *   - weak_ptr inside enable_shared_from_this is valid
-     *   - Room can safely store the shared_ptr
+     *  PHASE 1: JOIN THE ROOM COMMUNITY - BUT NOT YET
+     *
+     * I used to join right here, and Room.join() sent the whole history
+     * before the client could say a word. A reconnecting client already
+     * has most of it: it opens with "RESUME <epoch> <seq>" and wants only
+     * what it missed. So joining waits (joinPending):
+     *   1. The client's first frame decides. RESUME joins with history
+     *      after that seq (all of it if the epoch is stale); anything else
+     *      joins with full history, then gets handled as usual (MUX
+     *      doesn't: its channels join one by one on OPEN)
+     *   2. A client that says nothing for joinWindow is an ordinary one -
+     *      onTimeout() joins it with full history
+     *
+     * Either way joinRoom() sends EPOCH first, then Room.join() delivers
+     * history, so the client still sees context before real-time flow.
      */
-    room.join(shared_from_this());
+    joinPending = true;  // see joinRoom()
+
+    // The memory budget evicts me from another thread; hop onto my own first.
+    memory.setEvict([weak = weak_from_this()]() {
+        if (auto self = weak.lock()) {
+            boost::asio::post(self->executor(), [self]() { self->evict(); });
+        }
+    });
 
     /*
      *  PHASE 2: START LISTENING FOR CLIENT MESSAGES
@@ -763,7 +1016,7 @@ void Session::start() {
      * Before this call:
      *   - Session exists but is dormant
      *   - No network activity
-     *   - Room knows about us but we're not processing messages
+     *   - Not in the Room yet - the first frame (or joinWindow) puts us there
      *
      * After this call:
      *   - Session is actively processing incoming data
@@ -775,7 +1028,17 @@ void Session::start() {
      *   1. Client disconnects (network error)
      *   2. Server shuts down (io_context stops)
      *   3. Unrecoverable protocol error occurs
+     *   4. The peer goes quiet for longer than the idle timeout
      */
+    lastInbound = wheel.now();
+    joinDeadline = lastInbound + wheel.toTicks(joinWindow);
+    timeoutEntry.callback = [weak = weak_from_this()]() {
+        if (auto self = weak.lock()) {
+            self->onTimeout();
+        }
+    };
+    armTimeouts();
+
     async_read();
 }
 
@@ -808,27 +1071,44 @@ void Session::async_read() {
                  * Success! Header arrived. Now decode it to get body length.
                  * The Message protocol uses length-prefixed messages.
                  */
+                lastInbound = wheel.now();
+                pingOutstanding = false;
+                /*
+                 * Sampled for tracing? Decided when a header arrives, not
+                 * when the read is armed: the wait before this is just the
+                 * client being quiet, and an idle connection shouldn't
+                 * take samples from busy ones.
+                 */
+                traceId = Tracer::sample();
+                if (traceId) {
+                    traceHeaderDone = Tracer::now();
+                }
                 if (incomingMessage.decodeHeader()) {
                     // Header is valid, now read the body
+                    readingBody = true;
+                    bodyStarted = lastInbound;
                     readMessageBody();
                 } else {
                     // Invalid header - disconnect this client
-                    std::cout << "Invalid message header from client" << std::endl;
-                    room.leave(shared_from_this());
+                    LOG_WARN("Invalid message header from client");
+                    ServerMetrics::get().protocolErrors.inc();
+                    close("bad header");
                 }
-            } else {
+            } else if (ec != boost::asio::error::operation_aborted) {
                 /*
                  * Something went wrong. Either the client disconnected cleanly
                  * (EOF) or there was a network error.
                  *
                  * Either way, I need to leave the room and clean up.
+                 * (operation_aborted means close() already did.)
                  */
-                room.leave(shared_from_this());
                 if (ec == boost::asio::error::eof) {
-                    std::cout << "Client disconnected" << std::endl;
+                    LOG_INFO("Client disconnected");
                 } else {
-                    std::cout << "Read error: " << ec.message() << std::endl;
+                    LOG_WARN("Read error: {}", ec.message());
+                    ServerMetrics::get().readErrors.inc();
                 }
+                close(nullptr);
             }
         });
 }
@@ -845,169 +1125,759 @@ void Session::readMessageBody() {
             if (!ec) {
                 /*
                  * Success! Complete message received. Extract the body text
-                 * and send it to the room for broadcasting.
+                 * and send it to the room for broadcasting - unless it's a
+                 * control frame, which is for me and nobody else.
                  */
-                write(incomingMessage);
+                readingBody = false;
+                ServerMetrics& metrics = ServerMetrics::get();
+                metrics.framesIn.inc();
+                metrics.bytesIn.inc(Message::header + incomingMessage.getBodyLength());
+                if (traceId && !incomingMessage.isControl()) {
+                    uint64_t bodyDone = Tracer::now();
+                    Tracer::span("read body", traceId, traceHeaderDone, bodyDone,
+                                 "bytes", incomingMessage.getBodyLength());
+                }
+                if (joinPending && incomingMessage.isControl() && incomingMessage.controlVerb() == "RESUME") {
+                    resume(incomingMessage.controlArgs());
+                } else {
+                    if (joinPending && !(incomingMessage.isControl() && incomingMessage.controlVerb() == "MUX")) {
+                        joinRoom(0);  // an old client talking first - join before its frame fans out
+                    }
+                    if (incomingMessage.isControl()) {
+                        handleControl(incomingMessage);
+                    } else {
+                        if (muxed) {
+                            writeOnChannel(incomingMessage);
+                        } else {
+                            write(incomingMessage);
+                        }
+                        // Handed to the Room: the client may send another.
+                        if (++inboundUngranted >= std::max<size_t>(1, flowWindow / 2) && creditPeer) {
+                            deliver(Message::control("CREDIT", std::to_string(inboundUngranted)));
+                            inboundUngranted = 0;
+                        }
+                    }
+                }
 
                 /*
                  * Keep listening for more messages. This recursive call creates
                  * an "async loop" - each completion triggers the next read.
+                 * (Unless the room is congested - see readNext().)
                  */
-                async_read();
-            } else {
+                readNext();
+            } else if (ec != boost::asio::error::operation_aborted) {
                 /*
                  * Read failed. Client probably disconnected.
                  */
-                room.leave(shared_from_this());
-                std::cout << "Read body error: " << ec.message() << std::endl;
+                LOG_WARN("Read body error: {}", ec.message());
+                ServerMetrics::get().readErrors.inc();
+                close(nullptr);
             }
         });
 }
 
+void Session::readNext() {
+    /*
+     * Backpressure: while anyone in the room is backlogged I don't read.
+     * The client's frames wait in the kernel, then its TCP window fills and
+     * its sends block - the pressure reaches the sender instead of piling up
+     * in some recipient's queue. A backlogged Session, or one waiting for
+     * credit, keeps reading: the CREDIT that unblocks it comes in that way.
+     */
+    if (flowWindow != 0 && room.congested() && !backlogged.load(std::memory_order_acquire) &&
+        heldForCredit.empty()) {
+        readPaused = true;
+        ServerMetrics::get().readPauses.inc();
+        room.whenClear([weak = weak_from_this()]() {
+            if (auto self = weak.lock()) {
+                boost::asio::post(self->executor(), [self]() { self->resumeReading(); });
+            }
+        });
+        return;
+    }
+    async_read();
+}
+
+void Session::resumeReading() {
+    if (!readPaused || closed) {
+        return;
+    }
+    readPaused = false;
+    lastInbound = wheel.now();  // quiet because I wasn't listening, not because it was
+    async_read();
+}
+
 void Session::async_write() {
     /*
      * Time to send a message to my client. But first, do I have anything to send?
+     *
+     * Only ever runs on my own executor with writeActive == true, so I'm the
+     * single consumer of outboundInbox and the sole owner of inFlight.
      */
-    if (outgoingMessages.empty()) {
+    collectOutbound();
+    if (inFlight.empty()) {
+        if (!heldForCredit.empty() && !creditStalled) {
+            /*
+             * Out of the client's credit. Go idle like below: producers
+             * restart the chain so control frames still get past the held
+             * chat (collectOutbound()), and onCredit() restarts it for the
+             * chat. Timed like a stuck write - see onTimeout().
+             */
+            creditStalled = true;
+            creditStalledSince = wheel.now();
+        }
+        if (upgradePending && heldForCredit.empty()) {
+            completeUpgrade();
+        }
+
+        /*
+         * Drained. Let anything still sitting in a corked socket go now.
+         */
+        if (corked) {
+            setCork(false);
+        }
+
+        /*
+         * Inbox looks empty - go idle. But a producer may have pushed after
+         * my pop() and lost the exchange because the flag was still set, so
+         * clear the flag and look again. Whoever sets it next owns the drain.
+         * Re-enter through post(), like ShmSession::flushOutbound(): while a
+         * push is half-linked, pop() returns nothing but empty() is false,
+         * and calling myself directly would recurse until that producer runs.
+         */
+        writeActive.store(false, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!outboundInbox.empty() && !writeActive.exchange(true, std::memory_order_seq_cst)) {
+            boost::asio::post(clientSocket.get_executor(), [self = shared_from_this()]() { self->async_write(); });
+        }
         return;  // Queue is empty, nothing to do
     }
 
+    if (shouldHold()) {
+        /*
+         * Mid-burst and the batch is still small: give other producers a few
+         * microseconds to add to it, then flush whatever we have.
+         */
+        EgressStats::global().held.fetch_add(1, std::memory_order_relaxed);
+        auto self = shared_from_this();
+        coalesceTimer->expires_after(coalesceWindow);
+        coalesceTimer->async_wait([this, self](boost::system::error_code) {
+            if (closed) {
+                return;
+            }
+            collectOutbound();
+            flushBatch();
+        });
+        return;
+    }
+
+    flushBatch();
+}
+
+void Session::collectOutbound() {
+    /*
+     * Pull queued frames into the batch. Capped so one enormous backlog
+     * doesn't become one enormous write that holds the socket (and my
+     * write timeout) hostage.
+     */
+    static const size_t maxBatchFrames = 64;
+    static const size_t maxBatchBytes = 64 * 1024;
+
+    while (inFlightRuns < maxBatchFrames && inFlightBytes < maxBatchBytes) {
+        /*
+         * Chat frames held for credit go first once there is credit again.
+         * Without credit I keep popping the inbox anyway: control frames
+         * (PONG, CREDIT, EPOCH...) need no credit and go out past the held
+         * chat, while chat joins the back of the held queue to keep order.
+         */
+        OutboundNode* node = nullptr;
+        bool fromHeld = !heldForCredit.empty() && creditUsed < creditLimit;
+        if (fromHeld) {
+            node = heldForCredit.front().release();
+            heldForCredit.pop_front();
+        } else {
+            MpscNode* popped = outboundInbox.pop();
+            if (popped == nullptr) {
+                break;
+            }
+            node = static_cast<OutboundNode*>(popped);
+        }
+        // The same broadcast for another of my MUX channels adds an id, not a frame.
+        bool repeat = node->channel != 0 && !inFlight.empty() && inFlight.back()->channel != 0 &&
+                      inFlight.back()->frame == node->frame && channelListFits(runListChars, node->channel);
+        if (!node->frame->msg.isControl()) {
+            if ((!fromHeld && !heldForCredit.empty()) || (!repeat && creditUsed >= creditLimit)) {
+                heldForCredit.emplace_back(node);
+                if (readPaused) {
+                    resumeReading();  // the CREDIT that releases it comes in by reading
+                }
+                continue;
+            }
+            if (!repeat) {
+                ++creditUsed;
+            }
+        }
+        inFlight.emplace_back(node);
+        if (node->channel != 0) {
+            runListChars = (repeat ? runListChars + 1 : 0) + channelIdChars(node->channel);
+        }
+        if (!repeat) {
+            ++inFlightRuns;
+            inFlightBytes += Message::header + node->frame->msg.getBodyLength();
+        }
+    }
+}
+
+bool Session::shouldHold() const {
+    if (!coalesceTimer || inFlightBytes >= coalesceBytes) {
+        return false;
+    }
+    // Adaptive: only hold while a burst is underway.
+    return std::chrono::steady_clock::now() - lastFlush < coalesceWindow;
+}
+
+void Session::flushBatch() {
     auto self = shared_from_this();
-    const Message& msg = outgoingMessages.front();
 
     /*
      * Send the complete Message protocol data: [4-byte header][body]
      * No newlines needed - the length prefix handles message boundaries.
+     * Several frames back to back are still a valid stream, so the batch
+     * goes out as one gathered write.
      */
-    size_t totalLength = Message::header + msg.getBodyLength();
+    writeBuffers.clear();
+    flushFrames.clear();
+    // buffers point into it - no reallocation mid-loop. Each node adds at most
+    // one SEQ, PROBE or CH; a run of MUX repeats adds one more CH up front.
+    flushFrames.reserve(inFlight.size() + inFlightRuns);
+    for (size_t i = 0; i < inFlight.size(); ++i) {
+        const auto& node = inFlight[i];
+        uint64_t seq = node->frame->seq;
+        if (seq != 0) {
+            if (seq != lastSentSeq + 1) {
+                const Message& marker = flushFrames.emplace_back(Message::control("SEQ", std::to_string(seq)));
+                writeBuffers.emplace_back(marker.data, Message::header + marker.getBodyLength());
+            }
+            lastSentSeq = seq;
+        }
+        const Message& msg = node->frame->msg;
+        if (seq == 0 && msg.isControl() && msg.controlVerb() == "PROBE") {
+            const Message& reply = flushFrames.emplace_back(stampProbe(msg));
+            writeBuffers.emplace_back(reply.data, Message::header + reply.getBodyLength());
+            continue;
+        }
+        if (node->channel != 0) {
+            /*
+             * Room::deliver() fans out under its lock, so a broadcast for
+             * several of my channels sits in the batch back to back. Name
+             * them all in one CH and write the frame once (again if the id
+             * list outgrows a frame - the same cut collectOutbound() made).
+             */
+            std::string ids = std::to_string(node->channel);
+            while (i + 1 < inFlight.size() && inFlight[i + 1]->channel != 0 &&
+                   inFlight[i + 1]->frame == node->frame && channelListFits(ids.size(), inFlight[i + 1]->channel)) {
+                ids += ',';
+                ids += std::to_string(inFlight[++i]->channel);
+            }
+            const Message& marker = flushFrames.emplace_back(Message::control("CH", ids));
+            writeBuffers.emplace_back(marker.data, Message::header + marker.getBodyLength());
+        }
+        writeBuffers.emplace_back(msg.data, Message::header + msg.getBodyLength());
+        if (node->frame->traceId) {
+            traceBatchStart = Tracer::now();
+        }
+    }
+    accountBuffers();
 
-    boost::asio::async_write(clientSocket,
-        boost::asio::buffer(msg.data, totalLength),
+    // Deep queue: cork so the kernel packs full segments across writes.
+    if (corkEnabled && !corked && (inFlight.size() > 1 || !outboundInbox.empty())) {
+        setCork(true);
+    }
+
+    writeStarted = wheel.now();
+
+    boost::asio::async_write(clientSocket, writeBuffers,
         [this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
             if (!ec) {
-                /*
-                 * Message sent successfully. Remove it from the queue.
-                 */
-                outgoingMessages.pop_front();
+                EgressStats& stats = EgressStats::global();
+                stats.writes.fetch_add(1, std::memory_order_relaxed);
+                stats.frames.fetch_add(inFlight.size(), std::memory_order_relaxed);
+                stats.bytes.fetch_add(bytes_transferred, std::memory_order_relaxed);
+                if (++writesSinceSample >= 64) {
+                    sampleSegments();
+                }
+
+                ServerMetrics& metrics = ServerMetrics::get();
+                metrics.framesOut.inc(inFlight.size());
+                metrics.bytesOut.inc(bytes_transferred);
+                metrics.writeBatchFrames.observe(inFlight.size());
+                metrics.outboundQueued.add(-static_cast<int64_t>(inFlight.size()));
+                memory.queued.fetch_sub(inFlight.size() * queuedFrameBytes, std::memory_order_relaxed);
+                if (flowWindow != 0 &&
+                    queuedFrames.fetch_sub(inFlight.size(), std::memory_order_relaxed) - inFlight.size() <=
+                        flowWindow / 2 &&
+                    backlogged.exchange(false, std::memory_order_acq_rel)) {
+                    room.setBacklogged(false);
+                }
+
+                auto written = std::chrono::steady_clock::now();
+                for (const auto& node : inFlight) {
+                    if (node->frame->timed()) {
+                        room.recordFanout(*node->frame, written);
+                    }
+                    if (node->frame->traceId) {
+                        uint64_t done = Tracer::now();
+                        Tracer::span("queue wait", node->frame->traceId, node->tracedAt, traceBatchStart);
+                        Tracer::span("write", node->frame->traceId, traceBatchStart, done,
+                                     "batch", inFlight.size());
+                    }
+                }
 
                 /*
-                 * Are there more messages waiting? If so, send the next one.
-                 * This creates a chain of writes that processes the entire
-                 * queue without blocking.
+                 * Batch sent successfully. Move on to whatever is next -
+                 * async_write() goes idle if the inbox is drained. This
+                 * creates a chain of writes that processes the entire queue
+                 * without blocking.
                  */
-                if (!outgoingMessages.empty()) {
-                    async_write();
-                }
+                inFlight.clear();
+                inFlightBytes = 0;
+                inFlightRuns = 0;
+                lastFlush = written;
+                async_write();
             } else {
                 /*
                  * Write failed. Client probably disconnected.
-                 * Clean up and leave the room.
+                 * Clean up and leave the room. writeActive stays set, so
+                 * nobody schedules another write on a dead socket; the
+                 * destructor frees what is left in the inbox.
                  */
-                std::cout << "Write error: " << ec.message() << std::endl;
-                room.leave(shared_from_this());
+                if (ec != boost::asio::error::operation_aborted) {
+                    LOG_WARN("Write error: {}", ec.message());
+                    ServerMetrics::get().writeErrors.inc();
+                }
+                ServerMetrics::get().outboundQueued.add(-static_cast<int64_t>(inFlight.size()));
+                memory.queued.fetch_sub(inFlight.size() * queuedFrameBytes, std::memory_order_relaxed);
+                queuedFrames.fetch_sub(inFlight.size(), std::memory_order_relaxed);
+                inFlight.clear();
+                inFlightBytes = 0;
+                inFlightRuns = 0;
+                close(nullptr);
             }
         });
 }
 
-// ============================================================================
-// SERVER INFRASTRUCTURE
-// ============================================================================
+void Session::accountBuffers() {
+    int64_t bytes = static_cast<int64_t>(sizeof(Session) +
+                                         writeBuffers.capacity() * sizeof(writeBuffers[0]) +
+                                         flushFrames.capacity() * sizeof(Message) +
+                                         inFlight.capacity() * sizeof(inFlight[0]) +
+                                         channels.size() * sizeof(MuxChannel));
+    if (bytes != accountedBuffers) {
+        memory.buffers.store(bytes, std::memory_order_relaxed);
+        accountedBuffers = bytes;
+    }
+}
+
+void Session::evict() {
+    close("evicted to stay under the memory budget");
+}
+
+void Session::setCork(bool on) {
+    if (setTcpCork(clientSocket.native_handle(), on)) {
+        corked = on;
+    } else {
+        corkEnabled = false;  // not a TCP socket, or not Linux - stop trying
+    }
+}
 
-void start_accept(tcp::acceptor& acceptor, Room& room) {
+void Session::sampleSegments() {
     /*
-     * I need to continuously accept new connections. But accept() is blocking -
-     * it waits until someone connects.
-     *
-     * async_accept() is non-blocking. It says "when someone connects, call
-     * this function" and returns immediately.
+     * TCP_INFO is a syscall, so it's sampled every 64 writes (and on close)
+     * rather than per write. Only the delta since the last sample is added,
+     * so the global numbers stay exact regardless of the sampling rate.
      */
+    writesSinceSample = 0;
+    if (localTransport) {
+        return;  // no TCP_INFO on a Unix socket
+    }
+    uint64_t bytesSent = 0;
+    uint64_t segments = 0;
+    if (!readTcpSegmentCounters(clientSocket.native_handle(), bytesSent, segments)) {
+        return;
+    }
+    EgressStats& stats = EgressStats::global();
+    stats.tcpBytes.fetch_add(bytesSent - sampledBytesSent, std::memory_order_relaxed);
+    stats.tcpSegments.fetch_add(segments - sampledSegments, std::memory_order_relaxed);
+    sampledBytesSent = bytesSent;
+    sampledSegments = segments;
+}
 
+void Session::close(const char* reason) {
     /*
-     * Create a socket for the incoming connection. async_accept needs somewhere
-     * to put the new connection when it arrives.
+     * Called from read/write error paths and from the timeout check, always
+     * on my own executor - so a plain bool is enough to make it idempotent.
      */
-    auto socket = std::make_shared<tcp::socket>(acceptor.get_executor());
+    if (closed) {
+        return;
+    }
+    closed = true;
 
-    acceptor.async_accept(*socket,
-        [&acceptor, &room, socket](boost::system::error_code ec) {
-            if (!ec) {
-                /*
-                 * Someone connected! Wrap their socket in a Session object
-                 * and start participating in the chat.
-                 */
-                auto session = std::make_shared<Session>(std::move(*socket), room);
-                session->start();
+    if (reason != nullptr) {
+        LOG_INFO("Closing client: {}", reason);
+    }
 
-                std::cout << "New client connected" << std::endl;
-            } else {
-                std::cout << "Accept error: " << ec.message() << std::endl;
-            }
+    wheel.cancel(timeoutEntry);
+    if (coalesceTimer) {
+        coalesceTimer->cancel();
+    }
+    sampleSegments();
+    room.leave(shared_from_this());
+    if (upgraded) {
+        upgraded->stop();
+    }
+    for (auto& [id, channel] : channels) {
+        room.leave(channel);
+    }
+    channels.clear();  // they hold me - this is what lets me go
+    if (backlogged.exchange(false, std::memory_order_acq_rel)) {
+        room.setBacklogged(false);  // nothing can queue for me after leave()
+    }
 
-            /*
-             * Keep accepting more connections. This recursive call creates
-             * an endless loop of accepts. Each success triggers another
-             * async_accept().
-             */
-            start_accept(acceptor, room);
-        });
+    boost::system::error_code ignored;
+    clientSocket.shutdown(StreamSocket::shutdown_both, ignored);
+    clientSocket.close(ignored);
 }
 
-int main(int argc, char* argv[]) {
+void Session::armTimeouts() {
     /*
-     * Server startup. The pattern:
-     * 1. Create the core objects (Room, io_context, acceptor)
-     * 2. Start accepting connections
-     * 3. Run the event loop
-     *
-     * Everything happens inside io.run() - that's where the async magic lives.
+     * Fire at the earliest deadline that could possibly matter. Anything that
+     * starts after this (a write, a body read) can't be due sooner than
+     * `now + shortest timeout`, so capping at that keeps the check honest
+     * without ever re-arming from the read/write paths.
      */
+    TimingWheel::Tick now = wheel.now();
+    TimingWheel::Tick next = 0;
+    auto consider = [&next](TimingWheel::Tick deadline) {
+        if (next == 0 || deadline < next) {
+            next = deadline;
+        }
+    };
 
-    try {
-        if (argc != 2) {
-            std::cerr << "Usage: " << argv[0] << " <port>\n";
-            return 1;
+    TimingWheel::Tick quietLimit = pingOutstanding ? idleTicks : heartbeatTicks;
+    if (quietLimit == 0) {
+        quietLimit = idleTicks != 0 ? idleTicks : heartbeatTicks;
+    }
+    if (quietLimit != 0) {
+        consider(lastInbound + quietLimit);
+    }
+    if (readTicks != 0) {
+        consider(readingBody ? bodyStarted + readTicks : now + readTicks);
+    }
+    if (writeTicks != 0) {
+        consider(!inFlight.empty() ? writeStarted + writeTicks
+                 : creditStalled   ? creditStalledSince + writeTicks
+                                   : now + writeTicks);
+    }
+    if (joinPending) {
+        consider(joinDeadline);
+    }
+    if (flowWindow != 0) {
+        // deliver() sets backlogged from other threads; I only notice it here.
+        consider(backlogTimed ? backlogSince + flowStallTicks : now + flowStallTicks);
+    }
+
+    if (next != 0) {
+        wheel.scheduleAt(timeoutEntry, next);
+    }
+}
+
+void Session::onTimeout() {
+    if (closed) {
+        return;
+    }
+    TimingWheel::Tick now = wheel.now();
+
+    if (joinPending && now >= joinDeadline) {
+        joinRoom(0);  // no RESUME - an ordinary client, give it everything
+    }
+
+    if (readTicks != 0 && readingBody && now - bodyStarted >= readTicks) {
+        ServerMetrics::get().timeouts.inc();
+        close("read timeout");
+        return;
+    }
+    if (writeTicks != 0 && !inFlight.empty() && now - writeStarted >= writeTicks) {
+        ServerMetrics::get().timeouts.inc();
+        close("write timeout");
+        return;
+    }
+    if (writeTicks != 0 && creditStalled && now - creditStalledSince >= writeTicks) {
+        // Frames held for credit are a write the client won't let finish.
+        ServerMetrics::get().timeouts.inc();
+        close("write timeout (no credit)");
+        return;
+    }
+    if (backlogged.load(std::memory_order_acquire)) {
+        if (!backlogTimed) {
+            backlogTimed = true;
+            backlogSince = now;
+        } else if (now - backlogSince >= flowStallTicks) {
+            ServerMetrics::get().timeouts.inc();
+            close("not draining its queue (flow control)");
+            return;
         }
+    } else {
+        backlogTimed = false;
+    }
+    if (idleTicks != 0 && !readPaused && now - lastInbound >= idleTicks) {
+        ServerMetrics::get().timeouts.inc();
+        close("idle timeout");
+        return;
+    }
 
-        /*
-         * The foundation objects:
-         * - Room: coordinates all the chat participants
-         * - io_context: the async event processing engine
-         * - endpoint: defines where to listen (IP + port)
-         * - acceptor: listens for incoming connections
-         */
-        Room room;
-        boost::asio::io_context io;
-        tcp::endpoint endpoint(tcp::v4(), std::atoi(argv[1]));
-        tcp::acceptor acceptor(io, endpoint);
+    /*
+     * Quiet but not dead yet: ask. Any frame back (the PONG, or just chat)
+     * resets lastInbound and clears pingOutstanding.
+     */
+    if (heartbeatTicks != 0 && !pingOutstanding && !readPaused && now - lastInbound >= heartbeatTicks) {
+        pingOutstanding = true;
+        deliver(Message::control("PING"));
+    }
 
-        std::cout << "Chat server listening on port " << argv[1] << std::endl;
+    armTimeouts();
+}
 
+void Session::handleControl(const Message& msg) {
+    /*
+     * PONG needs no handling beyond the lastInbound stamp every frame gets.
+     * PING from the client is answered so clients can probe us too.
+     * Anything else is a verb from a newer client - ignore it.
+     */
+    if (msg.controlVerb() == "PING") {
+        deliver(Message::control("PONG", std::string(msg.controlArgs())));
+    } else if (msg.controlVerb() == "PROBE") {
         /*
-         * Start the accept loop. Once this starts, the server will
-         * continuously accept new connections.
+         * A PING that also wants to know how long its reply sat in my
+         * outbound queue (behind fan-out, coalescing, a slow socket). The
+         * queued frame carries the read time; flushBatch() swaps in the
+         * real reply once the wait is over - see stampProbe().
          */
-        start_accept(acceptor, room);
+        std::string args(msg.controlArgs());
+        if (args.size() <= probeArgsLimit) {
+            deliver(Message::control("PROBE", (args.empty() ? "@" : args + " @") + std::to_string(steadyNanos())));
+        }
+    } else if (msg.controlVerb() == "RESUME") {
+        // Too late - already joined with full history. The client drops
+        // what it has by seq.
+    } else if (msg.controlVerb() == "SHM") {
+        requestUpgrade();
+    } else if (msg.controlVerb() == "CREDIT") {
+        onCredit(msg.controlArgs());
+    } else if (msg.controlVerb() == "MUX") {
+        startMux();
+    } else if (muxed && msg.controlVerb() == "CH") {
+        inboundChannel = static_cast<uint32_t>(std::strtoul(std::string(msg.controlArgs()).c_str(), nullptr, 10));
+    } else if (muxed && msg.controlVerb() == "OPEN") {
+        openChannel(msg.controlArgs());
+    } else if (muxed && msg.controlVerb() == "CLOSE") {
+        closeChannel(msg.controlArgs());
+    }
+}
 
-        /*
-         * Run the event loop. This is where the server "lives".
-         * io.run() processes async events until the program exits:
-         *
-         * - New connections arrive → create Sessions
-         * - Data arrives from clients → parse into Messages
-         * - Messages need broadcasting → send to all participants
-         * - Clients disconnect → clean up Sessions
-         *
-         * All of this happens in a single thread through the magic of
-         * async I/O. No thread synchronization needed.
-         */
-        io.run();
+void Session::joinRoom(uint64_t resumeAfter) {
+    joinPending = false;
+    deliver(Message::control("EPOCH", std::to_string(room.epoch())));
+    room.join(shared_from_this(), resumeAfter);
+}
+
+void Session::resume(std::string_view args) {
+    /*
+     * "RESUME" alone is a fresh client that understands seqs; with
+     * "<epoch> <seq>" it's a reconnect. A different epoch means the server
+     * restarted and the client's seq means nothing here - full history.
+     */
+    std::string text(args);
+    unsigned long long epoch = 0;
+    unsigned long long seq = 0;
+    uint64_t after = 0;
+    if (std::sscanf(text.c_str(), "%llu %llu", &epoch, &seq) == 2 && epoch == room.epoch()) {
+        after = seq;
+        ServerMetrics::get().resumes.inc();
+    }
+    joinRoom(after);
+}
+
+void Session::onCredit(std::string_view args) {
+    /*
+     * Only with --flow-window. Without it nothing bounds what I'd hold for
+     * a client that grants once and goes quiet, short of the memory budget.
+     */
+    uint64_t frames = std::strtoull(std::string(args).c_str(), nullptr, 10);
+    if (frames == 0 || flowWindow == 0) {
+        return;
+    }
+    creditLimit = creditLimit == UINT64_MAX ? frames : creditLimit + frames;
+    creditStalled = false;
+
+    if (!creditPeer && flowWindow != 0) {
+        // It speaks CREDIT, so it gets a window too - plus whatever it sent
+        // before asking, which I've already taken.
+        creditPeer = true;
+        deliver(Message::control("CREDIT", std::to_string(flowWindow + inboundUngranted)));
+        inboundUngranted = 0;
+    }
+
+    if (!heldForCredit.empty() && !writeActive.exchange(true, std::memory_order_seq_cst)) {
+        async_write();  // idle since it ran out; producers may never wake it
+    }
+}
+
+void Session::startMux() {
+    if (muxed) {
+        return;
+    }
+    if (maxChannels == 0 || upgraded) {
+        deliver(Message::control("MUX", "unavailable"));
+        return;
+    }
+    muxed = true;
+    if (joinPending) {
+        joinPending = false;  // never joined - but channels want the epoch for OPEN
+        deliver(Message::control("EPOCH", std::to_string(room.epoch())));
+    } else {
+        room.leave(shared_from_this());
+    }
+    deliver(Message::control("MUX", std::to_string(maxChannels)));
+}
+
+void Session::openChannel(std::string_view args) {
+    std::string text(args);
+    unsigned long id = 0;
+    unsigned long long epoch = 0;
+    unsigned long long seq = 0;
+    int fields = std::sscanf(text.c_str(), "%lu %llu %llu", &id, &epoch, &seq);
+    if (fields < 1 || id == 0 || id > UINT32_MAX) {
+        ServerMetrics::get().protocolErrors.inc();
+        return;
+    }
+    uint32_t channelId = static_cast<uint32_t>(id);
+    if (channels.count(channelId) != 0) {
+        return;
+    }
+    if (channels.size() >= maxChannels) {
+        deliver(Message::control("CLOSE", std::to_string(channelId) + " full"));
+        return;
+    }
+
+    uint64_t after = 0;
+    if (fields == 3 && epoch == room.epoch()) {
+        after = seq;
+        ServerMetrics::get().resumes.inc();
+    }
+    auto channel = std::make_shared<MuxChannel>(shared_from_this(), room, channelId);
+    channels.emplace(channelId, channel);
+    accountBuffers();
+    room.join(channel, after);
+}
+
+void Session::closeChannel(std::string_view args) {
+    auto found = channels.find(static_cast<uint32_t>(std::strtoul(std::string(args).c_str(), nullptr, 10)));
+    if (found == channels.end()) {
+        return;
+    }
+    room.leave(found->second);
+    channels.erase(found);
+    accountBuffers();
+}
 
+void Session::writeOnChannel(Message& msg) {
+    /*
+     * Chat on a carrier has to say whose it is, every time: the CH right
+     * before it. Without one (or for a channel that's gone) there is nobody
+     * to send it as.
+     */
+    auto found = channels.find(inboundChannel);
+    inboundChannel = 0;
+    if (found == channels.end()) {
+        LOG_DEBUG("Dropping chat frame without an open channel");
+        return;
+    }
+    room.deliver(found->second, makeFrame(msg, Frame::Clock::now(), traceId));
+}
+
+void Session::requestUpgrade() {
+    if (!localTransport || upgraded || muxed || shmRingBytes == 0) {
+        deliver(Message::control("SHM", "unavailable"));
+        return;
+    }
+
+    try {
+        upgraded = std::make_shared<ShmSession>(executor(), room, shmRingBytes);
     } catch (std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        LOG_ERROR("Shared-memory upgrade failed: {}", e.what());
+        deliver(Message::control("SHM", "unavailable"));
+        return;
     }
 
-    return 0;
+    /*
+     * From here on broadcasts go into the ring. The ring just buffers until
+     * the client has the fds; up to its capacity that's no different from
+     * frames queued on a slow socket.
+     */
+    upgraded->memoryAccount().setLabel(describePeer(clientSocket));
+    upgraded->memoryAccount().setEvict([weak = weak_from_this()]() {
+        if (auto self = weak.lock()) {
+            boost::asio::post(self->executor(), [self]() { self->evict(); });
+        }
+    });
+    room.replace(shared_from_this(), upgraded);
+    upgraded->start();
+
+    upgradePending = true;
+    if (!writeActive.exchange(true, std::memory_order_seq_cst)) {
+        async_write();  // idle right now - the reply goes out immediately
+    }
+}
+
+void Session::completeUpgrade() {
+    /*
+     * The reply is an ordinary control frame, "SHM <capacity>", sent with
+     * sendmsg() so the three fds can ride along as SCM_RIGHTS ancillary
+     * data. The frame is tiny and the socket buffer is empty (the write
+     * chain is idle), so a blocking-style one-shot send is fine here.
+     */
+    upgradePending = false;
+
+    Message reply = Message::control("SHM", std::to_string(upgraded->capacity()));
+    int fds[3] = {upgraded->regionFd(), upgraded->serverBellFd(), upgraded->clientBellFd()};
+
+    iovec iov;
+    iov.iov_base = reply.data;
+    iov.iov_len = Message::header + reply.getBodyLength();
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+    msghdr header;
+    std::memset(&header, 0, sizeof(header));
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    cmsghdr* rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+
+    ssize_t sent;
+    do {
+        sent = ::sendmsg(clientSocket.native_handle(), &header, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent != static_cast<ssize_t>(iov.iov_len)) {
+        close("shared-memory handoff failed");
+    }
 }
 
 /*
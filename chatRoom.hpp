@@ -1,9 +1,21 @@
+#include "frame.hpp"
+#include "memoryLedger.hpp"
 #include "message.hpp"
 #include <iostream>
 #include <set>
 #include <memory>
 #include <deque>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 #include <boost/asio.hpp>
+#include "mpscQueue.hpp"
+#include "serverConfig.hpp"
+#include "timingWheel.hpp"
+#include "trace.hpp"
 
 #ifndef CHATROOM_HPP
 #define CHATROOM_HPP
@@ -48,6 +60,18 @@
 
 using boost::asio::ip::tcp;
 
+/*
+ * Sessions don't care which address family their socket came from - TCP
+ * from the network, or a Unix domain socket from a process on the same
+ * host. generic::stream_protocol covers both; a tcp::socket converts into
+ * one by move.
+ */
+using StreamSocket = boost::asio::generic::stream_protocol::socket;
+
+class ShmSession;
+class MuxChannel;
+class LatencyHistogram;
+
 /*
  * ============================================================================
  * THE SYNC vs ASYNC REALIZATION
@@ -205,8 +229,15 @@ class Participant {
      *   - const makes the contract clear: "read-only access"
      *
      * Nuance: This is the "push" direction - Room pushing messages TO participants
+     *
+     * Update: "don't want 100 copies" turned out to be wishful - every
+     * Session copied the const Message& into its queue anyway. Room now
+     * builds one immutable Frame per broadcast and hands out the pointer
+     * (see frame.hpp). The Message overload is for a participant's own
+     * replies (PONG, SHM): it wraps the bytes in an untimed frame.
      */
-        virtual void deliver(const Message& msg) = 0;
+        virtual void deliver(const FramePtr& frame) = 0;
+        void deliver(const Message& msg) { deliver(makeFrame(msg)); }
 
     /*
      * write() - "I want to send a message"
@@ -333,6 +364,13 @@ typedef std::shared_ptr<Participant> ParticipantPtr;
 
 class Room {
     public:
+    /*
+     * The name only labels this room's metrics for now - there is one Room
+     * per server, but its fan-out latency is exported per room so that
+     * stays true when there are more.
+     */
+        explicit Room(const std::string& name = "main");
+
     /*
      * Hmm, how should I store the participants?
      *
@@ -399,9 +437,27 @@ class Room {
      * │  Perfect for chat room sizes (50-100 users)            │
      * └─────────────────────────────────────────────────────────┘
      */
-        void join(ParticipantPtr participant);
+        /*
+         * resumeAfter: replay only history frames with a higher seq - a
+         * reconnecting client already has the rest. 0 = all of it.
+         */
+        void join(ParticipantPtr participant, uint64_t resumeAfter = 0);
         void leave(ParticipantPtr participant);
 
+        /*
+         * Seqs restart at 1 with the process, so a resume is only valid
+         * against the same epoch - a random number picked at startup.
+         */
+        uint64_t epoch() const { return epoch_; }
+
+    /*
+     * replace() - hand one client's seat to a different Participant under
+     * a single lock, without history replay. Used when a Session upgrades
+     * to shared memory: a broadcast landing between a separate leave() and
+     * join() would otherwise be lost (or, the other way round, duplicated).
+     */
+        void replace(ParticipantPtr from, ParticipantPtr to);
+
     /*
      * Message broadcasting - the heart of the chat system:
      *
@@ -469,7 +525,25 @@ class Room {
      * │ They already see their message in their client.        │
      * └─────────────────────────────────────────────────────────┘
      */
-    void deliver(ParticipantPtr sender, const Message& msg);
+    void deliver(ParticipantPtr sender, const FramePtr& frame);
+
+    /*
+     * Called by a recipient when a timed frame has left for its client
+     * (write completion, or published to a shared-memory ring). Feeds this
+     * room's histogram and the server-wide one; lock-free, any thread.
+     */
+        void recordFanout(const Frame& frame, Frame::Clock::time_point written);
+
+    /*
+     * Flow control (--flow-window). A recipient whose queue passes its
+     * window calls setBacklogged(true), and false once it has drained to
+     * half. While anyone is backlogged the room is congested and senders
+     * stop reading their sockets; whenClear() runs resume (any thread)
+     * when the last backlog clears, or straight away if there is none.
+     */
+        void setBacklogged(bool on);
+        bool congested() const { return backlogged.load(std::memory_order_acquire) != 0; }
+        void whenClear(std::function<void()> resume);
 
     private:
     std::set<ParticipantPtr> participants;
@@ -553,7 +627,7 @@ class Room {
      * │  Perfect for sliding window of recent messages!         │
      * └─────────────────────────────────────────────────────────┘
      */
-        std::deque<Message> MessageQueue;
+        std::deque<FramePtr> MessageQueue;
 
     /*
      * Capacity planning thoughts:
@@ -574,6 +648,28 @@ class Room {
      * This isn't a hard limit in my current code (TODO), but documents intent.
      */
         static const size_t MaxParticipants = 100;
+
+    /*
+     * One Room, many io threads: once Sessions live on different worker
+     * io_contexts, join/leave/deliver can run concurrently. A plain mutex
+     * guards participants + history. It's held across the fan-out loop,
+     * which is fine because Session::deliver() only does a lock-free push -
+     * nobody blocks on I/O while holding it.
+     */
+        std::mutex mutex;
+
+        LatencyHistogram& fanoutLatency;
+
+        const uint64_t epoch_;
+        uint64_t lastSeq = 0;  // under mutex
+
+    // Not under `mutex`: setBacklogged(true) runs inside deliver()'s fan-out.
+        std::atomic<size_t> backlogged{0};
+        std::mutex clearMutex;
+        std::vector<std::function<void()>> waitingForClear;
+
+    // history = the frames MessageQueue pins (see memoryLedger.hpp).
+        MemoryAccount memory{"room"};
 };
 
 /*
@@ -707,7 +803,7 @@ class Session : public Participant, public std::enable_shared_from_this<Session>
      * Why not Room* ? I could, but reference makes it clear that room must
      * exist for the lifetime of Session. No null checking needed.
      */
-    Session(tcp::socket socket, Room& room);
+    Session(StreamSocket socket, Room& room, const SessionOptions& options = SessionOptions());
 
     /*
      * The start() method - why not do everything in the constructor?
@@ -750,7 +846,8 @@ class Session : public Participant, public std::enable_shared_from_this<Session>
      *   I need to tell Room "please broadcast this to everyone else"
      *   But first maybe I should validate it, add timestamp, etc.
      */
-    void deliver(const Message& msg) override;
+    using Participant::deliver;
+    void deliver(const FramePtr& frame) override;
     void write(Message& msg) override;
 
     /*
@@ -773,8 +870,21 @@ class Session : public Participant, public std::enable_shared_from_this<Session>
      */
         void async_read();
         void readMessageBody();
+        void readNext();
     void async_write();
 
+    /*
+     * Tearing a Session down used to be implicit: leave the Room, drop the
+     * last shared_ptr, let the socket destructor close the fd. That's fine
+     * when the peer hangs up. It's not fine when the SERVER decides the peer
+     * is dead (timeouts) - nothing would ever complete to drop those refs.
+     *
+     * close() is the one way out: idempotent, runs on my executor, leaves
+     * the Room, cancels my wheel entry and closes the socket so every
+     * pending operation completes with operation_aborted.
+     */
+    void close(const char* reason);
+
     private:
     /*
      * Data member design choices:
@@ -869,10 +979,249 @@ class Session : public Participant, public std::enable_shared_from_this<Session>
      * │  Result: Messages sent in order, no corruption! ✓      │
      * └─────────────────────────────────────────────────────────┘
      */
-        tcp::socket clientSocket;
+    /*
+     * Update: the deque stopped being enough once delivery could come from
+     * more than one thread. Pushing into a std::deque from Room::deliver() on
+     * another thread while my own callback pops from it is a data race, and
+     * wrapping it in a mutex means every broadcast contends on every
+     * recipient's lock.
+     *
+     * So the outbound side is now split in two:
+     *
+     *   outboundInbox - lock-free MPSC queue. Anyone may push, only my own
+     *                   executor pops. Producers never block.
+     *
+     *   inFlight      - the frames currently being written. Owned by the
+     *                   write chain, so nobody else can touch them.
+     *
+     * And the "queue length == 1 means start writing" trick doesn't survive
+     * concurrency either (two producers can both observe size 2). The write
+     * state is now an explicit atomic flag, see Session::deliver().
+     */
+    struct OutboundNode : MpscNode {
+        OutboundNode(const FramePtr& f, uint32_t ch) : frame(f), channel(ch) {}
+        FramePtr frame;
+        uint32_t channel;       // MuxChannel id, 0 = for the connection itself
+        uint64_t tracedAt = 0;  // Tracer::now() at push, traced frames only
+    };
+
+    public:
+    ~Session();
+
+    // The worker io_context this Session lives on. Everything that touches
+    // the socket or the write chain runs here.
+    StreamSocket::executor_type executor() { return clientSocket.get_executor(); }
+
+    // deliver() for one of my MUX channels: same queue, tagged. Any thread.
+    void deliverOnChannel(uint32_t channel, const FramePtr& frame);
+
+    private:
+        StreamSocket clientSocket;
         Message incomingMessage;
         Room& room;
-    std::deque<Message> outgoingMessages;
+    MpscQueue outboundInbox;
+    std::vector<std::unique_ptr<OutboundNode>> inFlight;
+    std::atomic<bool> writeActive{false};
+
+    /*
+     * Egress batching. One async_write() per frame turned a busy room into a
+     * stream of tiny TCP segments - 30 bytes of chat, 40+ bytes of headers,
+     * one syscall each. Now the write chain:
+     *
+     *   1. always gathers whatever is already queued (up to a cap) into one
+     *      scatter/gather write - free, it adds no latency;
+     *
+     *   2. optionally HOLDS a small batch for up to coalesceWindow, but only
+     *      while a burst is underway (the previous flush finished less than
+     *      a window ago). A lone message on a quiet session goes out at once;
+     *
+     *   3. optionally CORKs the socket while the queue is deep and uncorks
+     *      when it drains, letting the kernel build full-size segments.
+     *
+     * writeBuffers keeps its capacity between writes so gathering doesn't
+     * allocate per flush.
+     */
+    void collectOutbound();
+    bool shouldHold() const;
+    void flushBatch();
+    void setCork(bool on);
+    void sampleSegments();
+
+    size_t inFlightBytes = 0;
+    size_t inFlightRuns = 0;  // frame copies the batch writes; MUX repeats are free
+    size_t runListChars = 0;  // CH id list of the run at inFlight.back()
+    std::vector<boost::asio::const_buffer> writeBuffers;
+    std::optional<boost::asio::steady_timer> coalesceTimer;
+    std::chrono::microseconds coalesceWindow{0};
+    size_t coalesceBytes = 0;
+    bool corkEnabled = false;
+    bool corked = false;
+    std::chrono::steady_clock::time_point lastFlush;
+    uint32_t writesSinceSample = 0;
+    uint64_t sampledBytesSent = 0;
+    uint64_t sampledSegments = 0;
+
+    /*
+     * Liveness. A peer that vanishes without a FIN (cable pulled, NAT entry
+     * expired, laptop lid closed) used to sit in the Room forever while its
+     * inbox grew. Now each Session has ONE entry on its worker's timing
+     * wheel and a few tick stamps:
+     *
+     *   lastInbound     any frame from the client, PONGs included
+     *   bodyStarted     header arrived, body still outstanding
+     *   writeStarted    the write in inFlight began
+     *
+     * Reads and writes only update stamps - they never touch the wheel. The
+     * entry fires at the earliest possible deadline, looks at the stamps,
+     * and either acts (PING / close) or re-arms. That keeps the per-frame
+     * cost at one integer store.
+     */
+    void armTimeouts();
+    void onTimeout();
+    void handleControl(const Message& msg);
+
+    TimingWheel& wheel;
+    TimingWheel::Entry timeoutEntry;
+    TimingWheel::Tick heartbeatTicks = 0;
+    TimingWheel::Tick idleTicks = 0;
+    TimingWheel::Tick readTicks = 0;
+    TimingWheel::Tick writeTicks = 0;
+    TimingWheel::Tick lastInbound = 0;
+    TimingWheel::Tick bodyStarted = 0;
+    TimingWheel::Tick writeStarted = 0;
+    bool readingBody = false;
+    bool pingOutstanding = false;
+    bool closed = false;
+
+    /*
+     * Resume. A reconnecting client's first frame is "RESUME <epoch> <seq>"
+     * and it only wants what it missed, so I don't join the Room (which is
+     * what replays history) until the first frame arrives or joinWindow
+     * passes. Clients that never send RESUME see history that much later;
+     * nothing else changes for them. Joining starts with "EPOCH <epoch>".
+     *
+     * Outbound, broadcasts carry the Room's seq. Whenever the seqs a client
+     * sees would skip - its own messages aren't echoed, history starts
+     * mid-stream - a "SEQ <n>" control goes out just ahead of the frame, so
+     * the client always knows the seq of what it has. A pure reader pays
+     * one marker per connection.
+     */
+    static constexpr std::chrono::milliseconds joinWindow{200};
+    void joinRoom(uint64_t resumeAfter);
+    void resume(std::string_view args);
+
+    bool joinPending = false;
+    TimingWheel::Tick joinDeadline = 0;
+    uint64_t lastSentSeq = 0;
+    std::vector<Message> flushFrames;  // built by flushBatch() (SEQ, PROBE), kept alive for the write
+
+    /*
+     * Shared-memory upgrade (Unix domain sockets only, see shmRing.hpp).
+     *
+     * "SHM" from the client swaps Room membership over to a ShmSession
+     * straight away, so no broadcast lands in the old queue after the ring
+     * exists. The reply carrying the fds goes out once my write chain is
+     * idle - anything already queued on the socket is delivered first,
+     * which keeps the client's view in order.
+     *
+     * The socket stays open afterwards as the control channel: heartbeats
+     * and timeouts keep working unchanged, and when it closes the ring
+     * session goes with it.
+     */
+    void requestUpgrade();
+    void completeUpgrade();
+
+    bool localTransport = false;
+    size_t shmRingBytes = 0;
+    bool upgradePending = false;
+    std::shared_ptr<ShmSession> upgraded;
+
+    /*
+     * Multiplexing (see muxChannel.hpp). "MUX" - as the first frame, in
+     * place of RESUME - makes this connection a carrier: I leave the Room
+     * (or never join it) and answer "MUX <limit>". Then:
+     *
+     *   OPEN <id> [<epoch> <seq>]   join channel <id>, replaying history
+     *                               after <seq> when the epoch matches
+     *   CLOSE <id>                  leave it ("CLOSE <id> full" back when
+     *                               an OPEN is over the limit)
+     *   CH <id>                     the next chat frame is from <id>
+     *
+     * Outbound, each channel frame follows a "CH <id>,<id>,..." naming every
+     * channel it is for, so a broadcast to 500 of my channels costs one copy
+     * in the write, not 500 (flushBatch()). EPOCH, SEQ, PING and the rest
+     * stay per connection and carry no CH.
+     */
+    void startMux();
+    void openChannel(std::string_view args);
+    void closeChannel(std::string_view args);
+    void writeOnChannel(Message& msg);
+
+    size_t maxChannels = 0;
+    bool muxed = false;
+    uint32_t inboundChannel = 0;
+    std::unordered_map<uint32_t, std::shared_ptr<MuxChannel>> channels;
+
+    /*
+     * Flow control (CREDIT, see message.hpp).
+     *
+     * Outbound (only with --flow-window; otherwise CREDIT is ignored):
+     * once my client grants credit, chat frames it has no credit for move
+     * from the inbox to heldForCredit, in order. Control frames don't need
+     * credit and still go out past them. The next CREDIT restarts the
+     * write chain for the held chat. A client that leaves them held for
+     * the write timeout is closed, as if a write were stuck.
+     *
+     * Backlog (--flow-window N, 0 = off): past N queued frames I mark
+     * myself backlogged in the Room, and every other Session stops reading
+     * after its current frame (readNext()). That pushes back through their
+     * socket buffers and TCP windows to the senders, instead of my queue
+     * growing. I clear the mark at N/2. A backlog that lasts longer than
+     * --flow-stall gets me closed, so one stuck client can't hold the room
+     * forever. That bound is always on, whatever the write timeout says.
+     *
+     * Inbound: a client that sends CREDIT gets "CREDIT N" back and then
+     * "CREDIT <k>" for every N/2 chat frames I've handed to the Room. While
+     * I'm paused those grants stop too.
+     */
+    void onCredit(std::string_view args);
+    void resumeReading();
+
+    size_t flowWindow = 0;
+    uint64_t creditLimit = UINT64_MAX;  // chat frames the client allows, cumulative
+    uint64_t creditUsed = 0;
+    std::deque<std::unique_ptr<OutboundNode>> heldForCredit;
+    bool creditStalled = false;  // nothing to write but heldForCredit
+    TimingWheel::Tick creditStalledSince = 0;
+    bool creditPeer = false;
+    uint64_t inboundUngranted = 0;
+    std::atomic<size_t> queuedFrames{0};
+    std::atomic<bool> backlogged{false};
+    bool backlogTimed = false;
+    TimingWheel::Tick flowStallTicks = 1;
+    TimingWheel::Tick backlogSince = 0;
+    bool readPaused = false;
+
+    /*
+     * Memory accounting (memoryLedger.hpp). queued moves by
+     * queuedFrameBytes per frame in deliver() and at write completion;
+     * buffers is recomputed when a batch is built and only stored if it
+     * changed. evict() is what --memory-budget and /evict call.
+     */
+    static const size_t queuedFrameBytes = sizeof(OutboundNode) + frameFootprint;
+    void accountBuffers();
+    void evict();
+
+    MemoryAccount memory{"session"};
+    int64_t accountedBuffers = 0;
+
+    /*
+     * Tracing (trace.hpp). The sampling decision is made as each header
+     * arrives; the timestamps are only taken when traceId != 0.
+     */
+    uint32_t traceId = 0;
+    uint64_t traceHeaderDone = 0;
+    uint64_t traceBatchStart = 0;
 };
 
 /*
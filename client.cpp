@@ -1,11 +1,268 @@
+#include "chatConnection.hpp"
 #include "message.hpp"
+#include "shmRing.hpp"
 #include <iostream>
 #include <boost/asio.hpp>
 #include <thread>
 #include <string>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+#include <cerrno>
+#include <chrono>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using boost::asio::ip::tcp;
 
+/*
+ * Command-line switches after <host> <port>:
+ *
+ *   --shm       shared-memory transport (unix:<path> servers only)
+ *   --bulk      non-interactive feed: stdin is piped lines, sent as fast as
+ *               the server takes them; incoming chat isn't printed
+ *   --rate N    at most N lines per second (--bulk only, 0 = unlimited)
+ *   --probe     measure round trips instead of chatting (see ProbeStats):
+ *     --interval MS     between probes (default 100)
+ *     --count N         stop after N probes (default 0 = until stdin ends)
+ *     --server-delay    also ask the server how long each reply was queued
+ *   --window N  let the server run at most N messages ahead of what I've
+ *               shown (CREDIT flow control, 0 = unlimited)
+ *   --history FILE  keep the room's recent history in FILE between runs and
+ *               only ask the server for what's newer (not with --shm: ring
+ *               traffic bypasses the connection that records it)
+ */
+struct ClientOptions {
+    bool shm = false;
+    bool bulk = false;
+    size_t rate = 0;
+    bool probe = false;
+    size_t probeIntervalMs = 100;
+    size_t probeCount = 0;
+    bool serverDelay = false;
+    size_t window = 0;
+    std::string historyFile;
+};
+
+/*
+ * 🖨️ BATCHED RENDERING (io thread only)
+ *
+ * Every incoming message used to be getBody() into a fresh std::string and
+ * then `std::cout << ... << std::endl` - an allocation and a flush, so one
+ * write() to the terminal, per line. In a busy room the terminal set the
+ * pace: the receive loop fell behind, the socket buffer filled and the
+ * server started treating me as a slow reader.
+ *
+ * Now each body is appended (straight from the receive buffer, no copy in
+ * between) to one reused buffer, which goes out in a single write when it
+ * fills up or when flushDelay has passed since the first line in it -
+ * short enough that a human never notices. Anything else printed from the
+ * io thread flushes first, so notices stay in order with the chat.
+ *
+ * It also counts what it renders: rendered messages/s per one-second
+ * window, with the total and the peak reported on the way out.
+ */
+class TerminalRenderer {
+public:
+    explicit TerminalRenderer(boost::asio::io_context& io) : flushTimer(io) {
+        buffer.reserve(flushBytes + Message::header + Message::maxBytes);
+    }
+
+    void message(std::string_view body) {
+        buffer += "📩 ";
+        buffer += body;
+        buffer += '\n';
+        ++pending;
+        if (buffer.size() >= flushBytes) {
+            flush();
+        } else if (!timerArmed) {
+            timerArmed = true;
+            flushTimer.expires_after(flushDelay);
+            flushTimer.async_wait([this](boost::system::error_code ec) {
+                timerArmed = false;
+                if (!ec) {
+                    flush();
+                }
+            });
+        }
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            std::cout.write(buffer.data(), buffer.size());
+            std::cout.flush();
+            buffer.clear();  // keeps its capacity
+        }
+        count(pending);
+        pending = 0;
+    }
+
+    void cancel() {
+        flushTimer.cancel();
+    }
+
+    void summary() const {
+        if (total == 0) {
+            return;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+        uint64_t average = uint64_t(total / std::max(seconds, 1.0));
+        std::cerr << "📊 Rendered " << total << " messages, " << average << " msgs/s average, "
+                  << std::max(peakRate, average) << " msgs/s peak" << std::endl;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t flushBytes = 64 * 1024;
+    static constexpr std::chrono::milliseconds flushDelay{10};
+
+    void count(uint64_t rendered) {
+        auto now = Clock::now();
+        if (total == 0 && windowCount == 0) {
+            started = windowStart = now;
+        }
+        total += rendered;
+        windowCount += rendered;
+        double elapsed = std::chrono::duration<double>(now - windowStart).count();
+        if (elapsed >= 1.0) {
+            peakRate = std::max(peakRate, uint64_t(windowCount / elapsed));
+            windowCount = 0;
+            windowStart = now;
+        }
+    }
+
+    std::string buffer;
+    boost::asio::steady_timer flushTimer;
+    bool timerArmed = false;
+    uint64_t pending = 0;
+
+    uint64_t total = 0;
+    uint64_t windowCount = 0;
+    uint64_t peakRate = 0;
+    Clock::time_point started;
+    Clock::time_point windowStart;
+};
+
+/*
+ * 📡 PROBE MODE - measuring what a user actually waits for
+ *
+ * loadgen measures the server under load from the inside of a benchmark;
+ * nothing told us what a real client on a real network sees. --probe
+ * sends "PING <id> <sent ns>" every --interval and the server echoes the
+ * arguments in its PONG, so the RTT needs no table on my side - the id is
+ * only there to spot losses and duplicates.
+ *
+ * With --server-delay the verb is PROBE instead: the server appends how
+ * long the reply waited in its outbound queue (behind fan-out, coalescing,
+ * a slow socket), so RTT minus that is roughly the network plus both read
+ * paths.
+ *
+ * Every sample is kept (8 bytes each; a day at 10/s is 7 MB) so the
+ * percentiles are exact. Jitter is the RFC 3550 estimator: a running
+ * average of |rtt[i] - rtt[i-1]| with gain 1/16.
+ */
+class ProbeStats {
+public:
+    uint64_t sent() const { return answered.size(); }
+
+    // The id to put in the next probe; sent() it once the connection took it.
+    uint64_t nextId() const { return answered.size(); }
+    void sending() { answered.push_back(false); }
+
+    // Refused by send() (backpressure, or closing): never sent, so not lost.
+    void refused() { ++refusedCount; }
+
+    void reply(uint64_t id, uint64_t rtt, const uint64_t* serverDelay) {
+        if (id >= answered.size()) {
+            return;  // not one of mine
+        }
+        if (answered[id]) {
+            ++duplicates;
+            return;
+        }
+        answered[id] = true;
+        ++answeredCount;
+        if (!rtts.empty()) {
+            double delta = double(rtt > rtts.back() ? rtt - rtts.back() : rtts.back() - rtt);
+            jitter += (delta - jitter) / 16.0;
+        }
+        rtts.push_back(rtt);
+        if (serverDelay != nullptr) {
+            serverDelays.push_back(*serverDelay);
+        }
+    }
+
+    bool allAnswered() const { return answeredCount == answered.size(); }
+    uint64_t answeredTotal() const { return answeredCount; }
+
+    void report(std::ostream& out) const {
+        out << std::fixed << std::setprecision(1)
+            << "probes     " << sent() << " sent  " << answeredCount << " answered  "
+            << sent() - answeredCount << " lost  " << duplicates << " duplicate";
+        if (refusedCount != 0) {
+            out << "  " << refusedCount << " not sent (send queue full)";
+        }
+        out << "\n";
+        if (rtts.empty()) {
+            return;
+        }
+        std::vector<uint64_t> sorted(rtts);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (uint64_t rtt : sorted) {
+            sum += double(rtt);
+        }
+        out << "rtt us     min " << micros(sorted.front()) << "  p50 " << micros(quantile(sorted, 0.5))
+            << "  p90 " << micros(quantile(sorted, 0.9)) << "  p99 " << micros(quantile(sorted, 0.99))
+            << "  max " << micros(sorted.back()) << "  mean " << sum / double(sorted.size()) / 1000.0 << "\n"
+            << "jitter us  " << jitter / 1000.0 << " (RFC 3550)\n";
+        if (!serverDelays.empty()) {
+            std::vector<uint64_t> delays(serverDelays);
+            std::sort(delays.begin(), delays.end());
+            out << "server us  p50 " << micros(quantile(delays, 0.5)) << "  p90 " << micros(quantile(delays, 0.9))
+                << "  p99 " << micros(quantile(delays, 0.99)) << "  max " << micros(delays.back())
+                << "  (queued in the server before the reply was written)\n";
+        }
+
+        // Power-of-two microsecond buckets, from the first one used to the last.
+        std::vector<uint64_t> buckets(64, 0);
+        for (uint64_t rtt : sorted) {
+            uint64_t us = std::max<uint64_t>(rtt / 1000, 1);
+            ++buckets[63 - __builtin_clzll(us)];
+        }
+        size_t first = 63 - __builtin_clzll(std::max<uint64_t>(sorted.front() / 1000, 1));
+        size_t last = 63 - __builtin_clzll(std::max<uint64_t>(sorted.back() / 1000, 1));
+        uint64_t tallest = *std::max_element(buckets.begin(), buckets.end());
+        out << "rtt histogram (us)\n";
+        for (size_t b = first; b <= last; ++b) {
+            size_t bar = size_t(40 * buckets[b] / tallest);
+            out << std::setw(10) << (uint64_t(1) << b) << " - " << std::setw(10) << (uint64_t(2) << b) << "  "
+                << std::string(bar, '#') << std::string(40 - bar, ' ') << "  " << buckets[b] << "\n";
+        }
+        out.flush();
+    }
+
+private:
+    static double micros(uint64_t nanos) { return double(nanos) / 1000.0; }
+
+    static uint64_t quantile(const std::vector<uint64_t>& sorted, double q) {
+        size_t rank = size_t(std::ceil(q * double(sorted.size())));
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+    std::vector<bool> answered;  // by id
+    uint64_t answeredCount = 0;
+    uint64_t duplicates = 0;
+    uint64_t refusedCount = 0;
+    std::vector<uint64_t> rtts;  // ns, in arrival order
+    std::vector<uint64_t> serverDelays;
+    double jitter = 0;
+};
+
 /*
  * ============================================================================
  * CHAT CLIENT - A Journey Through Network Programming Paradigms
@@ -69,17 +326,59 @@ private:
      *   - Threading synchronization (io_context in background)
      *   - Graceful shutdown (cleanup on exit)
      *
-     * Each responsibility became a method. The class evolved organically.
+     * Each responsibility became a method. The class evolved organically -
+     * until the integration services wanted the networking half without
+     * the terminal, hundreds of connections to one thread. That half is
+     * ChatConnection now (chatConnection.hpp, libchatclient.a): connecting,
+     * the receiving loop, heartbeats, the pipelined send
+     * queue, reconnect + resume. What stays here is everything a human
+     * touches: stdin, stdout, and the shared-memory rings.
      */
     boost::asio::io_context io;          // The async event processor
-    tcp::socket socket;                  // My lifeline to the server
-    Message readMessage;                 // Reusable buffer for incoming data
-    std::string serverHost;              // Where to connect
+    std::shared_ptr<ChatConnection> connection;  // Socket, reads, writes, reconnects
+    std::string serverHost;              // Where to connect ("unix:/path" = local)
     std::string serverPort;              // Which port to connect to
+    TerminalRenderer renderer{io};       // Incoming chat → stdout, in batches
+
+    /*
+     * 📤 Backpressure for producers: the connection refuses frames while
+     * its queue is full, and the stdin thread waits here until a write
+     * completes (or the connection gives up).
+     */
+    std::mutex pendingMutex;
+    std::condition_variable pendingDrained;
+
+    /*
+     * 🧠 Shared-memory mode (local clients only, see shmRing.hpp). Chat
+     * frames travel through two rings in a memfd; the socket stays up for
+     * heartbeats. Empty unless the upgrade succeeded.
+     */
+    bool wantShm = false;
+    bool bulk = false;
+    size_t rate = 0;
+    std::unique_ptr<ShmRegion> region;
+    std::optional<ShmRing> toServer;
+    std::optional<ShmRing> fromServer;
+    int serverBell = -1;
+    std::optional<boost::asio::posix::stream_descriptor> myBell;
+    Message ringMessage;
+
+    // 📡 Probe mode (io thread, except probeDone under pendingMutex).
+    bool probe = false;
+    std::chrono::milliseconds probeInterval;
+    size_t probeCount = 0;
+    bool serverDelay = false;
+    ProbeStats probeStats;
+    boost::asio::steady_timer probeTimer{io};
+    std::chrono::steady_clock::time_point nextProbe;
+    bool probeGrace = false;
+    bool probeDone = false;
 
 public:
-    ChatClient(const std::string& host, const std::string& port)
-        : socket(io), serverHost(host), serverPort(port) {
+    ChatClient(const std::string& host, const std::string& port, const ClientOptions& options = {})
+        : serverHost(host), serverPort(port), wantShm(options.shm), bulk(options.bulk), rate(options.rate),
+          probe(options.probe), probeInterval(options.probeIntervalMs), probeCount(options.probeCount),
+          serverDelay(options.serverDelay) {
         /*
          * 🤔 DESIGN QUESTION: Why pass host/port to constructor vs connect()?
          *
@@ -95,6 +394,39 @@ public:
          * 🧭 I chose immutability over flexibility. Chat clients typically
          *    connect once and stay connected.
          */
+        ChatConnection::Handlers handlers;
+        handlers.message = [this](std::string_view body) {
+            if (!bulk && !probe) {
+                renderer.message(body);
+            }
+        };
+        handlers.control = [this](std::string_view verb, std::string_view args) {
+            if (probe && (verb == "PONG" || verb == "PROBE")) {
+                probeReply(verb, args);
+            }
+        };
+        handlers.connected = [this]() {
+            // Only reconnects get here: the first connect is connectNow().
+            renderer.flush();
+            std::cout << "🔄 Reconnected, catching up" << std::endl;
+        };
+        handlers.disconnected = [this](const std::string& why, bool retrying) {
+            renderer.flush();
+            std::cerr << "❌ Connection lost: " << why << (retrying ? " - reconnecting" : "") << std::endl;
+            wakeProducers();  // a quitting stdin thread stops waiting for the drain
+        };
+        handlers.drained = [this]() { wakeProducers(); };
+        handlers.serverRestarted = [this]() {
+            renderer.flush();
+            std::cout << "ℹ️  Server restarted - showing its history from the start" << std::endl;
+        };
+
+        ChatConnection::Options connectionOptions;
+        // The rings die with the connection; re-upgrading isn't worth it.
+        connectionOptions.reconnect = !wantShm;
+        connectionOptions.creditWindow = options.window;
+        connectionOptions.historyFile = options.historyFile;
+        connection = ChatConnection::create(io, serverHost, serverPort, std::move(handlers), connectionOptions);
     }
 
     void connect() {
@@ -125,24 +457,34 @@ public:
          *
          *    Redundancy for reliability. If one fails, try the next.
          *
-         * 3. boost::asio::connect(socket, endpoints)
-         *    The magic function that tries each endpoint until one works.
+         * 3. Try each endpoint until one connects
          *
-         *    🤯 Mind-bending realization: This function call might:
+         *    🤯 Mind-bending realization: This might:
          *       - Try IPv4, fail → try IPv6, succeed
          *       - Try server 1, timeout → try server 2, succeed
          *       - Handle DNS resolution failures
          *       - Deal with network routing issues
          *
          *    All invisibly! That's why networking libraries are so valuable.
+         *
+         * ChatConnection::connectNow() does all of that synchronously, so a
+         * typo in the hostname fails right here instead of in the background.
          */
         try {
-            tcp::resolver resolver(io);
-            auto endpoints = resolver.resolve(serverHost, serverPort);
-            boost::asio::connect(socket, endpoints);
+            connection->connectNow();
 
-            std::cout << "✅ Connected to chat server!" << std::endl;
-            std::cout << "Type messages and press Enter. Type 'quit' to exit.\n" << std::endl;
+            if (wantShm) {
+                upgradeToShm();
+            }
+
+            if (bulk) {
+                std::cerr << "✅ Connected, feeding stdin" << std::endl;
+            } else if (probe) {
+                std::cerr << "✅ Connected, probing every " << probeInterval.count() << "ms" << std::endl;
+            } else {
+                std::cout << "✅ Connected to chat server!" << std::endl;
+                std::cout << "Type messages and press Enter. Type 'quit' to exit.\n" << std::endl;
+            }
 
         } catch (std::exception& e) {
             /*
@@ -155,201 +497,436 @@ public:
              *
              * 🧭 Decision: Fail fast, let user decide
              * Rationale: Chat clients need immediate feedback, not mysterious delays
+             *
+             * (Once a connection has worked, a drop IS retried - that's a
+             * network hiccup, not a typo.)
              */
             std::cerr << "❌ Connection failed: " << e.what() << std::endl;
             throw;  // Re-throw to let main() handle final cleanup
         }
     }
 
-    void startReceiving() {
+private:
+    void wakeProducers() {
+        // Taking the lock orders this after a producer's failed send() + wait.
+        { std::lock_guard<std::mutex> lock(pendingMutex); }
+        pendingDrained.notify_all();
+    }
+
+    void sendFrames(std::vector<Message>&& frames) {
+        /*
+         * 🚚 PIPELINED SENDS:
+         *
+         * This used to be a blocking boost::asio::write() on the stdin
+         * thread, under a mutex shared with the io thread's PONGs. One
+         * stalled socket and input froze; a script piping lines in paid a
+         * full write() per line.
+         *
+         * Now the frames are handed to the connection, which queues them on
+         * the io thread and keeps a single gathered async_write going (same
+         * rule as the server's Session: one write in flight, everything
+         * else waits its turn). The caller returns immediately - unless the
+         * connection's queue is already full, in which case the server is
+         * far behind and the producer waits for it rather than growing the
+         * queue forever.
+         */
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        while (!connection->send(std::move(frames))) {  // refused: frames untouched
+            if (connection->isClosed()) {
+                throw std::runtime_error("connection is closed");
+            }
+            pendingDrained.wait(lock);
+        }
+    }
+
+    void sendFrame(const Message& msg) {
+        std::vector<Message> frames;
+        frames.push_back(msg);
+        sendFrames(std::move(frames));
+    }
+
+    void writeNow(const Message& msg) {
+        // Only before the connection is started (the shared-memory handshake).
+        boost::asio::write(connection->socket(), boost::asio::buffer(msg.data, Message::header + msg.getBodyLength()));
+    }
+
+    void drainOutbound(std::chrono::seconds limit) {
+        // Bounded: a server that stopped reading shouldn't hang "quit".
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingDrained.wait_for(lock, limit, [this]() {
+            return connection->queuedBytes() == 0 || connection->isClosed() || !connection->isConnected();
+        });
+    }
+
+    void sendBatch(std::vector<Message>&& batch) {
+        /*
+         * Bulk mode's sendFrame(): one hand-off (and one backpressure
+         * check) for a few hundred lines instead of one each.
+         */
+        if (batch.empty()) {
+            return;
+        }
+        if (toServer) {
+            for (const Message& msg : batch) {
+                sendRing(msg);
+            }
+            batch.clear();
+            return;
+        }
+        sendFrames(std::move(batch));
+        batch.clear();
+    }
+
+    void sendProbe() {
+        /*
+         * On a fixed schedule (nextProbe += interval), not "interval after
+         * the last one", so a slow tick doesn't stretch the run. No probes
+         * while reconnecting - they'd measure the backoff, not the network.
+         */
+        if (probeCount != 0 && probeStats.sent() >= probeCount) {
+            finishProbing();
+            return;
+        }
+        if (connection->isConnected()) {
+            uint64_t id = probeStats.nextId();
+            uint64_t sentAt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now().time_since_epoch()).count();
+            if (connection->send(Message::control(serverDelay ? "PROBE" : "PING",
+                                                  std::to_string(id) + " " + std::to_string(sentAt)))) {
+                probeStats.sending();
+            } else {
+                probeStats.refused();  // the network never saw it - don't call it lost
+            }
+        }
+        nextProbe += probeInterval;
+        probeTimer.expires_at(nextProbe);
+        probeTimer.async_wait([this](boost::system::error_code ec) {
+            if (!ec) {
+                sendProbe();
+            }
+        });
+    }
+
+    void probeReply(std::string_view verb, std::string_view args) {
+        // PONG "<id> <sent ns>", PROBE "<id> <sent ns> <queued ns>"
+        unsigned long long id = 0, sentAt = 0, queued = 0;
+        int fields = std::sscanf(std::string(args).c_str(), "%llu %llu %llu", &id, &sentAt, &queued);
+        if (fields < 2) {
+            return;  // someone else's PING
+        }
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch()).count();
+        uint64_t delay = queued;
+        probeStats.reply(id, now > sentAt ? now - sentAt : 0,
+                         verb == "PROBE" && fields == 3 ? &delay : nullptr);
+        if (probeCount != 0 && probeStats.sent() >= probeCount && probeStats.allAnswered()) {
+            finishProbing();
+        }
+    }
+
+    void finishProbing() {
         /*
-         * 🎭 THE ASYNC RECEIVING DANCE - Act 1: Header Reading
-         *
-         * 🤔 FUNDAMENTAL QUESTION: Why read header separately from body?
-         *
-         * Alternative 1: Read everything at once
-         *   Problem: How much to read? TCP is a STREAM, not packets.
-         *
-         *   Imagine server sends: "0005Hello0003Bye"
-         *   If I read 10 bytes, I get: "0005Hello0"
-         *   Now what? I'm in the middle of the second message!
-         *
-         * Alternative 2: Read header first, then body (CHOSEN)
-         *   Step 1: Read exactly 4 bytes → "0005"
-         *   Step 2: Parse 5 as body length
-         *   Step 3: Read exactly 5 bytes → "Hello"
-         *   Step 4: Message complete! Start over.
-         *
-         * 🧠 INSIGHT: Length-prefixed protocols REQUIRE two-phase reading
-         *
-         * 🎯 EXECUTION VISUALIZATION:
-         *
-         * Time 0: [Start async_read for 4 bytes]
-         *   ↓
-         * Time 5ms: [Header arrives: "0013"]
-         *   ↓
-         * Time 5ms: [Callback fires, decode: body_length = 13]
-         *   ↓
-         * Time 5ms: [Start async_read for 13 bytes]
-         *   ↓
-         * Time 12ms: [Body arrives: "Hello, world!"]
-         *   ↓
-         * Time 12ms: [Message complete, display to user]
-         *   ↓
-         * Time 12ms: [Recursively call startReceiving()]
-         *
-         * Notice: Each step is NON-BLOCKING. Main thread continues handling user input.
+         * The last probe's reply gets a grace period (a second, or ten
+         * intervals if that's longer); whatever hasn't answered by then is
+         * lost.
          */
-        boost::asio::async_read(socket,
-            boost::asio::buffer(readMessage.data, Message::header),
-            [this](boost::system::error_code ec, std::size_t bytes_transferred) {
-                /*
-                 * 🧠 CALLBACK PSYCHOLOGY:
-                 *
-                 * This function runs in the FUTURE. When I wrote this code,
-                 * the network data didn't exist yet. Now it does.
-                 *
-                 * Mental model shift required:
-                 *   Sequential: "Do A, then B, then C"
-                 *   Async: "Start A, when A completes someday, do B"
-                 *
-                 * 🤔 QUESTION: What if socket gets destroyed before callback runs?
-                 * Answer: [this] capture keeps ChatClient alive via socket reference
-                 *
-                 * More elegant would be: [self = shared_from_this()]
-                 * But ChatClient isn't designed for shared ownership currently.
-                 */
+        if (probeStats.allAnswered()) {
+            probeTimer.cancel();
+            markProbeDone();
+        } else if (!probeGrace) {
+            probeGrace = true;
+            probeTimer.expires_after(std::max<std::chrono::milliseconds>(std::chrono::seconds(1), 10 * probeInterval));
+            probeTimer.async_wait([this](boost::system::error_code ec) {
                 if (!ec) {
-                    /*
-                     * 🎉 SUCCESS PATH: Header arrived successfully
-                     *
-                     * Now the crucial question: Is this header VALID?
-                     *
-                     * What could go wrong?
-                     *   - Corrupted data: "xyz3" instead of "0003"
-                     *   - Network noise: Random bytes
-                     *   - Protocol violation: Client sent wrong format
-                     *   - Integer overflow: "9999999" (too big)
-                     *
-                     * decodeHeader() does the validation. If it fails,
-                     * we COULD try to recover, but protocol corruption
-                     * usually means something fundamental is wrong.
-                     *
-                     * 🧭 Philosophy: Fail fast on protocol errors
-                     */
-                    if (readMessage.decodeHeader()) {
-                        readBodyData();  // Proceed to phase 2
-                    } else {
-                        std::cerr << "❌ Invalid message header received" << std::endl;
-                        startReceiving(); // Try again - maybe just one bad message
-                    }
-                } else if (ec != boost::asio::error::operation_aborted) {
-                    /*
-                     * 💥 FAILURE PATH: Something went wrong
-                     *
-                     * 🤔 Why check for operation_aborted specifically?
-                     *
-                     * operation_aborted = Normal shutdown scenario
-                     *   - User typed "quit"
-                     *   - We called socket.close()
-                     *   - Async operations get cancelled
-                     *   - No need to alarm the user
-                     *
-                     * Other errors = Real problems:
-                     *   - Server crashed
-                     *   - Network cable unplugged
-                     *   - Firewall blocked connection
-                     *   - User should know about these
-                     */
-                    std::cerr << "❌ Connection lost: " << ec.message() << std::endl;
+                    markProbeDone();
                 }
             });
+        }
     }
 
-private:
-    void readBodyData() {
+    void markProbeDone() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            probeDone = true;
+        }
+        pendingDrained.notify_all();
+    }
+
+    void runProbe() {
+        boost::asio::post(io, [this]() {
+            nextProbe = std::chrono::steady_clock::now();
+            sendProbe();
+        });
+        if (probeCount == 0) {
+            // Until stdin ends (Ctrl-D, "quit", or the pipe closing), then the same grace.
+            std::string input;
+            while (std::getline(std::cin, input) && input != "quit" && input != "exit") {
+            }
+            boost::asio::post(io, [this]() {
+                probeCount = std::max<size_t>(probeStats.sent(), 1);
+                if (!probeGrace) {
+                    probeTimer.cancel();  // the next sendProbe() won't come
+                    finishProbing();
+                }
+            });
+        }
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingDrained.wait(lock, [this]() { return probeDone || connection->isClosed(); });
+    }
+
+    void pumpBulk() {
         /*
-         * 🎭 THE ASYNC RECEIVING DANCE - Act 2: Body Reading
+         * 📦 BULK MODE - deploy bots piping log lines in.
          *
-         * 🎯 MEMORY LAYOUT AWARENESS:
+         * getline() + one sendMessage() per line topped out at a few
+         * thousand lines/s. Here stdin is read in 64 KiB blocks, lines are
+         * found with memchr() and encoded straight into Messages (no
+         * std::string per line), and a few hundred at a time go to the io
+         * thread, which writes them as gathered batches.
          *
-         * After header reading:
-         *   readMessage.data = ['0', '0', '1', '3', ?, ?, ?, ...]
-         *                       ↑_________________↑
-         *                       Header (4 bytes)
+         * Lines longer than a frame are split into frame-sized pieces
+         * rather than dropped; empty lines are skipped like in chat mode.
          *
-         * Now I need to read INTO positions 4-16:
-         *   readMessage.data + Message::header = pointer to position 4
-         *   getBodyLength() = 13 (from decoded header)
-         *
-         * After body reading:
-         *   readMessage.data = ['0', '0', '1', '3', 'H', 'e', 'l', 'l', 'o', ...]
-         *                       ↑_________________↑ ↑_________________________↑
-         *                       Header (4 bytes)   Body (13 bytes)
+         * --rate is a token bucket refilled at N/s holding up to a tenth of
+         * a second's worth, so a bot can't swamp the room but a short burst
+         * after a quiet spell isn't smeared out either.
+         */
+        using Clock = std::chrono::steady_clock;
+        const size_t batchLines = 256;
+        double tokens = 0;
+        double bucket = rate > 0 ? std::max(1.0, rate / 10.0) : 0;
+        Clock::time_point refilled = Clock::now();
+        auto started = refilled;
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+
+        std::vector<Message> batch;
+        batch.reserve(batchLines);
+        auto emit = [&](const char* text, size_t length) {
+            if (rate > 0) {
+                auto now = Clock::now();
+                tokens = std::min(bucket, tokens + std::chrono::duration<double>(now - refilled).count() * rate);
+                refilled = now;
+                if (tokens < 1) {
+                    sendBatch(std::move(batch));  // don't hold lines while sleeping
+                    batch.reserve(batchLines);
+                    std::this_thread::sleep_for(std::chrono::duration<double>((1 - tokens) / rate));
+                    tokens = 1;
+                    refilled = Clock::now();
+                }
+                tokens -= 1;
+            }
+            Message& msg = batch.emplace_back();
+            msg.setBodyLength(length);
+            msg.encodeHeader();
+            std::memcpy(msg.data + Message::header, text, length);
+            ++lines;
+            bytes += length;
+            if (batch.size() == batchLines) {
+                sendBatch(std::move(batch));
+                batch.reserve(batchLines);
+            }
+        };
+        auto emitLine = [&](const char* text, size_t length) {
+            if (length > 0 && text[length - 1] == '\r') {
+                --length;
+            }
+            const size_t piece = Message::maxBytes;
+            for (size_t offset = 0; offset < length; offset += piece) {
+                emit(text + offset, std::min(piece, length - offset));
+            }
+        };
+
+        std::vector<char> block(64 * 1024);
+        size_t carried = 0;  // start of an unfinished line, moved to the front
+        try {
+            for (;;) {
+                if (carried == block.size()) {
+                    emitLine(block.data(), carried);  // a 64 KiB "line": flush what there is
+                    carried = 0;
+                }
+                ssize_t got = ::read(STDIN_FILENO, block.data() + carried, block.size() - carried);
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    break;
+                }
+                const char* start = block.data();
+                const char* end = block.data() + carried + got;
+                const char* scan = block.data() + carried;
+                while (const char* newline = static_cast<const char*>(std::memchr(scan, '\n', end - scan))) {
+                    emitLine(start, newline - start);
+                    start = scan = newline + 1;
+                }
+                carried = end - start;
+                std::memmove(block.data(), start, carried);
+                if (batch.size() > 0 && got < static_cast<ssize_t>(block.size() / 2)) {
+                    sendBatch(std::move(batch));  // input is trickling - don't sit on it
+                    batch.reserve(batchLines);
+                }
+            }
+            emitLine(block.data(), carried);
+            sendBatch(std::move(batch));
+        } catch (std::exception& e) {
+            std::cerr << "❌ Bulk feed stopped: " << e.what() << std::endl;
+        }
+
+        drainOutbound(std::chrono::seconds(60));
+        double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+        std::cerr << "📦 Sent " << lines << " lines (" << bytes << " bytes) in " << seconds << "s, "
+                  << (seconds > 0 ? uint64_t(lines / seconds) : lines) << " lines/s" << std::endl;
+    }
+
+    bool isLocal() const { return serverHost.rfind("unix:", 0) == 0; }
+
+    void upgradeToShm() {
+        /*
+         * 🔌 THE UPGRADE HANDSHAKE (synchronous - nothing async is running yet):
          *
-         * 🧠 POINTER ARITHMETIC INSIGHT:
-         * Why not just use a separate buffer for body?
+         *   me → "SHM"
+         *   server → (history replay, maybe some live chat) ... "SHM <capacity>"
+         *            with [memfd, server bell, my bell] attached via SCM_RIGHTS
          *
-         * Because Message class is designed for zero-copy operations:
-         *   - Single buffer holds complete message
-         *   - No need to concatenate header + body later
-         *   - Efficient for sending (just pointer + length)
-         *   - Memory layout matches wire format exactly
+         * Frames before the reply are printed as usual. Everything after it
+         * arrives through the ring, so nothing is lost or reordered.
+         */
+        if (!isLocal()) {
+            throw std::runtime_error("--shm needs a unix:<path> server address");
+        }
+        writeNow(Message::control("SHM"));
+
+        std::vector<int> passed;
+        Message frame;
+        for (;;) {
+            receiveExact(frame.data, Message::header, passed);
+            if (!frame.decodeHeader()) {
+                throw std::runtime_error("invalid header during shared-memory upgrade");
+            }
+            receiveExact(frame.data + Message::header, frame.getBodyLength(), passed);
+
+            if (!frame.isControl()) {
+                renderer.message(std::string_view(frame.data + Message::header, frame.getBodyLength()));
+            } else if (frame.controlVerb() == "PING") {
+                writeNow(Message::control("PONG", std::string(frame.controlArgs())));
+            } else if (frame.controlVerb() == "SHM") {
+                break;
+            }
+        }
+
+        if (frame.controlArgs() == "unavailable" || passed.size() != 3) {
+            for (int fd : passed) {
+                ::close(fd);
+            }
+            std::cerr << "⚠️  Server refused shared memory, staying on the socket" << std::endl;
+            return;
+        }
+
+        region = ShmRegion::attach(passed[0]);
+        fromServer.emplace(region->serverToClient());
+        toServer.emplace(region->clientToServer());
+        serverBell = passed[1];
+        myBell.emplace(io, passed[2]);
+        renderer.flush();
+        std::cout << "⚡ Using shared-memory transport (" << region->capacity()
+                  << "-byte rings)" << std::endl;
+    }
+
+    void receiveExact(char* buffer, size_t length, std::vector<int>& passed) {
+        /*
+         * recvmsg() instead of read(): the fds come as ancillary data on
+         * whichever call picks up the first byte of the reply. On a Unix
+         * stream socket the kernel never merges data across that boundary,
+         * so each call sees at most one batch.
          */
-        boost::asio::async_read(socket,
-            boost::asio::buffer(readMessage.data + Message::header, readMessage.getBodyLength()),
-            [this](boost::system::error_code ec, std::size_t bytes_transferred) {
+        size_t done = 0;
+        while (done < length) {
+            iovec iov;
+            iov.iov_base = buffer + done;
+            iov.iov_len = length - done;
+            alignas(cmsghdr) char control[CMSG_SPACE(3 * sizeof(int))];
+            msghdr header;
+            std::memset(&header, 0, sizeof(header));
+            header.msg_iov = &iov;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            ssize_t got = ::recvmsg(connection->socket().native_handle(), &header, MSG_CMSG_CLOEXEC);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                throw std::runtime_error("connection closed during shared-memory upgrade");
+            }
+            for (cmsghdr* c = CMSG_FIRSTHDR(&header); c != nullptr; c = CMSG_NXTHDR(&header, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+                    size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    for (size_t i = 0; i < count; ++i) {
+                        int fd;
+                        std::memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+                        passed.push_back(fd);
+                    }
+                }
+            }
+            done += static_cast<size_t>(got);
+        }
+    }
+
+    void waitForRing() {
+        /*
+         * Same doorbell protocol as the server side: announce I'm going to
+         * sleep, re-check, and only then block on the eventfd.
+         */
+        if (!fromServer->armConsumerWait()) {
+            boost::asio::post(io, [this]() { drainRing(); });
+            return;
+        }
+        myBell->async_wait(boost::asio::posix::stream_descriptor::wait_read,
+            [this](boost::system::error_code ec) {
                 if (!ec) {
-                    /*
-                     * 🎉 COMPLETE MESSAGE RECEIVED!
-                     *
-                     * 🤔 PROCESSING QUESTION: What should I do with this message?
-                     *
-                     * Option 1: Just print it
-                     *   Simple, but no room for growth
-                     *
-                     * Option 2: Parse it for commands (like "/who", "/quit")
-                     *   More features, but client gets complex
-                     *
-                     * Option 3: Forward to a handler interface
-                     *   Extensible, but over-engineered for simple chat
-                     *
-                     * 🧭 Choice: Keep it simple for now, but extract to method
-                     *    for future extensibility
-                     */
-                    std::string messageBody = readMessage.getBody();
-                    std::cout << "📩 " << messageBody << std::endl;
-
-                    /*
-                     * 🔄 THE ASYNC LOOP:
-                     *
-                     * This recursive call creates an infinite async loop:
-                     *
-                     *   startReceiving() → readBodyData() → startReceiving() → ...
-                     *
-                     * 🤔 Question: Is this safe? Won't it cause stack overflow?
-                     *
-                     * Answer: NO stack overflow because it's async!
-                     *
-                     * Call stack visualization:
-                     *
-                     * Traditional recursion (DANGEROUS):
-                     *   main() → recv1() → recv2() → recv3() → ... [STACK GROWS]
-                     *
-                     * Async recursion (SAFE):
-                     *   main() → startReceiving() → [callback scheduled] → main() returns
-                     *   [Later...] callback() → startReceiving() → [new callback] → callback() returns
-                     *
-                     * Each "recursion" actually returns to the event loop!
-                     * Stack depth stays constant.
-                     */
-                    startReceiving();
-                } else if (ec != boost::asio::error::operation_aborted) {
-                    std::cerr << "❌ Error reading message body: " << ec.message() << std::endl;
+                    drainRing();
                 }
             });
     }
 
+    void drainRing() {
+        clearDoorbell(myBell->native_handle());
+        for (;;) {
+            ShmRing::ReadResult result = fromServer->tryRead(ringMessage);
+            if (result == ShmRing::ReadResult::Empty) {
+                break;
+            }
+            if (result == ShmRing::ReadResult::Corrupt) {
+                renderer.flush();
+                std::cerr << "❌ Corrupt frame in shared-memory ring" << std::endl;
+                return;
+            }
+            if (!ringMessage.isControl()) {
+                renderer.message(std::string_view(ringMessage.data + Message::header, ringMessage.getBodyLength()));
+            }
+        }
+        if (fromServer->producerNeedsWake()) {
+            ringDoorbell(serverBell);
+        }
+        waitForRing();
+    }
+
+    void sendRing(const Message& msg) {
+        /*
+         * Only the stdin thread produces into this ring (PONGs still go
+         * over the socket), so it stays single-producer. A full ring means
+         * the server is badly behind; a human typing can afford to spin
+         * politely until there's room.
+         */
+        while (!toServer->tryWrite(msg)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (toServer->consumerNeedsWake()) {
+            ringDoorbell(serverBell);
+        }
+    }
+
 public:
     void sendMessage(const std::string& messageText) {
         /*
@@ -363,16 +940,17 @@ public:
          *   - More complex error handling
          *   - Need to queue messages if user types fast
          *
-         * Option 2: Sync sending (CHOSEN)
+         * Option 2: Sync sending
          *   + Simple: just write and done
          *   + Immediate error feedback
          *   - Could block if network is slow
          *   + But sending is usually fast
          *
-         * 🧭 Decision rationale:
-         *    Humans type slowly compared to network speed.
-         *    If network is so slow that sending blocks noticeably,
-         *    the user experience is already terrible anyway.
+         * 🧭 I started with sync: humans type slowly compared to network
+         *    speed. Then stdin stopped being a human - a script piping
+         *    thousands of lines a second paid one blocking write() each,
+         *    and one stalled socket froze input entirely. Async won
+         *    (sendFrame()); errors surface on the next send instead.
          *
          * 🎯 MESSAGE CONSTRUCTION ANALYSIS:
          *
@@ -417,7 +995,11 @@ public:
              *   - Clean protocol compliance
              *   - Server gets exactly what it expects
              */
-            boost::asio::write(socket, boost::asio::buffer(msg.data, Message::header + msg.getBodyLength()));
+            if (toServer) {
+                sendRing(msg);
+            } else {
+                sendFrame(msg);
+            }
 
         } catch (std::exception& e) {
             /*
@@ -425,7 +1007,7 @@ public:
              *
              * What exceptions might happen here?
              *   1. Message constructor: length_error if message too long
-             *   2. boost::asio::write: network_error if connection broken
+             *   2. sendFrame(): runtime_error once the connection has given up
              *
              * 🤔 Should I retry automatically?
              *
@@ -443,7 +1025,7 @@ public:
         }
     }
 
-    void run() {
+    int run() {
         /*
          * 🎭 THE GRAND FINALE: Orchestrating Concurrent Operations
          *
@@ -470,7 +1052,7 @@ public:
          * │    ↓                                                        │
          * │  async_read completes → callback fires                     │
          * │    ↓                                                        │
-         * │  cout << "📩 " << message << endl;                         │
+         * │  renderer.message(body) → batched write to stdout          │
          * │    ↓                                                        │
          * │  startReceiving() → next async_read                        │
          * └─────────────────────────────────────────────────────────────┘
@@ -483,10 +1065,10 @@ public:
          *
          * 🛡️ THREAD SAFETY ANALYSIS:
          *   - std::cout: Thread-safe for individual << operations
-         *   - socket: boost::asio sockets are thread-safe for
-         *     simultaneous read/write (different directions)
+         *   - socket: only the io thread touches it now - sends are
+         *     handed to the connection and queued (see sendFrames())
          *
-         * So no explicit synchronization needed! Clean design.
+         * The one lock left is the one producers wait on while the queue is full.
          *
          * 🧭 ALTERNATIVE ARCHITECTURES CONSIDERED:
          *
@@ -506,7 +1088,10 @@ public:
          */
 
         // Flow 1: Start async message receiving in background
-        startReceiving();
+        connection->start();
+        if (fromServer) {
+            waitForRing();
+        }
 
         // Flow 2: Start IO event loop in separate thread
         std::thread ioThread([this]() {
@@ -531,7 +1116,12 @@ public:
 
         // Flow 3: Main thread handles user input (blocking)
         std::string input;
-        while (std::getline(std::cin, input)) {
+        if (bulk) {
+            pumpBulk();
+        } else if (probe) {
+            runProbe();
+        }
+        while (!bulk && !probe && std::getline(std::cin, input)) {
             /*
              * 🎯 USER INPUT PROCESSING:
              *
@@ -558,7 +1148,7 @@ public:
         /*
          * 🧹 GRACEFUL SHUTDOWN SEQUENCE:
          *
-         * 1. socket.close() → Cancels pending async operations
+         * 1. connection->close() → Cancels pending async operations
          * 2. io.stop() → Tells io.run() to exit event loop
          * 3. ioThread.join() → Wait for IO thread to finish cleanup
          *
@@ -567,9 +1157,27 @@ public:
          *
          * This sequence ensures clean shutdown without resource leaks.
          */
-        socket.close();  // Cancel async operations
-        io.stop();       // Exit event loop
+        drainOutbound(std::chrono::seconds(5));  // Piped input: don't drop the tail of the script
+        // The io thread owns the socket (it may be mid-reconnect), so it closes up.
+        connection->close();  // Cancel async operations
+        boost::asio::post(io, [this]() {
+            renderer.cancel();
+            renderer.flush();  // whatever arrived in the last few ms
+            if (myBell) {
+                myBell->close();
+            }
+            io.stop();       // Exit event loop
+        });
         ioThread.join(); // Wait for IO thread completion
+        renderer.summary();
+        if (serverBell >= 0) {
+            ::close(serverBell);
+        }
+        if (probe) {
+            probeStats.report(std::cout);
+            return probeStats.answeredTotal() > 0 ? 0 : 1;  // for monitoring: nothing came back
+        }
+        return 0;
     }
 };
 
@@ -591,7 +1199,7 @@ int main(int argc, char* argv[]) {
     /*
      * 📝 ARGUMENT VALIDATION:
      *
-     * Why require exactly 3 arguments?
+     * Why require at least 3 arguments?
      * argv[0] = program name ("./client")
      * argv[1] = host ("localhost" or "192.168.1.5")
      * argv[2] = port ("8080")
@@ -601,9 +1209,50 @@ int main(int argc, char* argv[]) {
      * 🧭 Design choice: Fail fast with clear usage message
      * Better than trying to guess defaults and confusing user.
      */
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <host> <port>" << std::endl;
+    std::string host = argc > 1 ? argv[1] : "";
+    bool local = host.rfind("unix:", 0) == 0;
+    int firstOption = local ? 2 : 3;
+    ClientOptions options;
+    bool valid = argc >= firstOption;
+    for (int i = firstOption; valid && i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--shm" && local) {
+            options.shm = true;
+        } else if (flag == "--bulk") {
+            options.bulk = true;
+        } else if (flag == "--rate" && i + 1 < argc) {
+            char* end = nullptr;
+            options.rate = std::strtoul(argv[++i], &end, 10);
+            valid = *end == '\0';
+        } else if (flag == "--probe") {
+            options.probe = true;
+        } else if ((flag == "--interval" || flag == "--count") && i + 1 < argc) {
+            char* end = nullptr;
+            size_t value = std::strtoul(argv[++i], &end, 10);
+            valid = *end == '\0' && (flag == "--count" || value > 0);
+            (flag == "--interval" ? options.probeIntervalMs : options.probeCount) = value;
+        } else if (flag == "--server-delay") {
+            options.serverDelay = true;
+        } else if (flag == "--window" && i + 1 < argc) {
+            char* end = nullptr;
+            options.window = std::strtoul(argv[++i], &end, 10);
+            valid = *end == '\0';
+        } else if (flag == "--history" && i + 1 < argc) {
+            options.historyFile = argv[++i];
+        } else {
+            valid = false;
+        }
+    }
+    valid = valid && !(options.bulk && options.probe) && !(options.shm && !options.historyFile.empty());
+    if (!valid || host.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <host> <port> [--bulk [--rate N]] [--window N] [--history FILE]"
+                  << std::endl;
+        std::cerr << "       " << argv[0] << " <host> <port> --probe [--interval MS] [--count N] [--server-delay]"
+                  << std::endl;
+        std::cerr << "       " << argv[0] << " unix:<path> [--shm] [--bulk [--rate N]]" << std::endl;
         std::cerr << "Example: " << argv[0] << " localhost 8080" << std::endl;
+        std::cerr << "         tail -F app.log | " << argv[0] << " localhost 8080 --bulk --rate 500" << std::endl;
+        std::cerr << "         " << argv[0] << " localhost 8080 --probe --count 600 --server-delay" << std::endl;
         return 1;
     }
 
@@ -620,9 +1269,9 @@ int main(int argc, char* argv[]) {
          *   6. run() returns, destructor cleans up
          *   7. main() returns 0 (success)
          */
-        ChatClient client(argv[1], argv[2]);
+        ChatClient client(host, local ? "" : argv[2], options);
         client.connect();
-        client.run();
+        return client.run();
 
     } catch (std::exception& e) {
         /*
@@ -668,7 +1317,6 @@ int main(int argc, char* argv[]) {
  *
  * 🎯 WHAT I'D DO DIFFERENTLY:
  *
- * - Add automatic reconnection for network failures
  * - Support for message history scrollback
  * - Better handling of large messages (progress indicators)
  * - Configuration file for default host/port
@@ -680,6 +1328,8 @@ int main(int argc, char* argv[]) {
  * - Robust error handling without over-engineering
  * - Efficient protocol implementation (zero-copy where possible)
  * - Threading model that's simple but effective
+ * - Surviving a dropped connection: ChatConnection reconnects with backoff
+ *   and RESUMEs from the last seq I printed (this used to top the list above)
  *
  * This client went from "just send messages" to a thoughtful piece of
  * software that handles the real complexities of network programming.
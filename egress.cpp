@@ -0,0 +1,32 @@
+#include "egress.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#include <cstddef>
+#include <cstring>
+
+bool readTcpSegmentCounters(int fd, uint64_t& bytesSent, uint64_t& dataSegments) {
+    struct tcp_info info;
+    std::memset(&info, 0, sizeof(info));
+    socklen_t length = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) != 0) {
+        return false;
+    }
+
+    /*
+     * Older kernels return a shorter struct. Only trust fields that were
+     * actually filled in.
+     */
+    const size_t needed = offsetof(struct tcp_info, tcpi_bytes_sent) + sizeof(info.tcpi_bytes_sent);
+    if (length < needed) {
+        return false;
+    }
+    bytesSent = info.tcpi_bytes_sent;
+    dataSegments = info.tcpi_data_segs_out;
+    return true;
+}
+
+bool setTcpCork(int fd, bool on) {
+    int value = on ? 1 : 0;
+    return setsockopt(fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+}
@@ -0,0 +1,51 @@
+#include <atomic>
+#include <cstdint>
+
+#ifndef EGRESS_HPP
+#define EGRESS_HPP
+
+/*
+ * ============================================================================
+ * EGRESS STATS - Is write combining actually paying off?
+ * ============================================================================
+ *
+ * "Fewer, bigger segments" is the whole point of batching and corking, so
+ * that's what gets measured:
+ *
+ *   frames / writes       how many frames each gathered write carried
+ *   bytes / segments      what the kernel actually put on the wire per
+ *                         data segment (from TCP_INFO, sampled, not per write)
+ *
+ * Counters are process-wide relaxed atomics; nobody reads them on the hot
+ * path.
+ * ============================================================================
+ */
+
+struct EgressStats {
+    std::atomic<uint64_t> writes{0};        // async_write() calls issued
+    std::atomic<uint64_t> frames{0};        // frames carried by those writes
+    std::atomic<uint64_t> bytes{0};         // bytes carried by those writes
+    std::atomic<uint64_t> held{0};          // batches held back by the window
+    std::atomic<uint64_t> tcpBytes{0};      // TCP_INFO bytes_sent (sampled)
+    std::atomic<uint64_t> tcpSegments{0};   // TCP_INFO data_segs_out (sampled)
+
+    static EgressStats& global() {
+        static EgressStats stats;
+        return stats;
+    }
+};
+
+/*
+ * Linux TCP helpers. These live in their own translation unit because the
+ * kernel's <linux/tcp.h> (which has the modern tcp_info fields) collides
+ * with the libc <netinet/tcp.h> that asio pulls in.
+ */
+
+// Cumulative data bytes / data segments sent on this socket. False if the
+// kernel doesn't report them (non-TCP socket, old kernel).
+bool readTcpSegmentCounters(int fd, uint64_t& bytesSent, uint64_t& dataSegments);
+
+// TCP_CORK on/off. Returns false if the option isn't supported.
+bool setTcpCork(int fd, bool on);
+
+#endif // EGRESS_HPP
@@ -0,0 +1,65 @@
+#include "message.hpp"
+#include <chrono>
+#include <memory>
+
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+/*
+ * ============================================================================
+ * FRAME - One broadcast, shared by every recipient
+ * ============================================================================
+ *
+ * Room::deliver() used to hand each participant a const Message&, and each
+ * Session copied it into its outbound node - 516 bytes per recipient, for
+ * bytes that are identical everywhere. Now the frame is built once, made
+ * immutable, and recipients hold a shared_ptr to it until their write
+ * completes.
+ *
+ * Being one object per broadcast also gives me somewhere to hang things
+ * that describe the broadcast rather than the bytes: `ingress` is stamped
+ * when the sender's read finishes, so every recipient's write completion
+ * can say how long the frame spent inside the server.
+ *
+ * Frames that aren't a fresh broadcast (control replies, history replay
+ * to a newcomer) leave ingress at the epoch and are never timed - a replay
+ * of a ten-minute-old message isn't a ten-minute fan-out.
+ *
+ * traceId is non-zero for the sampled few that record spans (trace.hpp).
+ *
+ * seq is the room's broadcast number, so a reconnecting client can say
+ * "I have everything up to 812" (Room::join). It can only be assigned under
+ * the room lock - that's what makes history order and seq order the same -
+ * and the frame is built before the lock is taken, so it is the one mutable
+ * field: Room::deliver() stamps it while the sender still holds the only
+ * reference, and nothing writes it after that.
+ * ============================================================================
+ */
+
+struct Frame {
+    using Clock = std::chrono::steady_clock;
+
+    Message msg;
+    Clock::time_point ingress{};
+    uint32_t traceId = 0;
+    mutable uint64_t seq = 0;  // 0 = not a room broadcast (control, reply)
+
+    bool timed() const { return ingress != Clock::time_point(); }
+};
+
+using FramePtr = std::shared_ptr<const Frame>;
+
+// What one held FramePtr keeps alive: the Frame and make_shared's control block.
+static const size_t frameFootprint = sizeof(Frame) + 2 * sizeof(long);
+
+inline FramePtr makeFrame(const Message& msg, Frame::Clock::time_point ingress = Frame::Clock::time_point(),
+                          uint32_t traceId = 0) {
+    return std::make_shared<const Frame>(Frame{msg, ingress, traceId});
+}
+
+// History replay: same bytes and seq, but untimed and untraced.
+inline FramePtr makeReplay(const Frame& original) {
+    return std::make_shared<const Frame>(Frame{original.msg, Frame::Clock::time_point(), 0, original.seq});
+}
+
+#endif // FRAME_HPP
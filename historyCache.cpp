@@ -0,0 +1,170 @@
+#include "historyCache.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// HISTORY CACHE - Load, append, rewrite
+// ============================================================================
+
+namespace {
+
+const char headerTag[] = "chat-history 1 ";
+
+std::string errnoText(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+}  // namespace
+
+HistoryCache::HistoryCache(const std::string& path, size_t capacity)
+    : path(path), capacity(capacity == 0 ? 1 : capacity) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error(errnoText("cannot open history cache", path));
+    }
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        throw std::runtime_error("history cache " + path + " is in use by another client");
+    }
+    try {
+        load();
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+HistoryCache::~HistoryCache() {
+    flush();      // best effort - the next run just replays a little more
+    ::close(fd);  // releases the lock
+}
+
+void HistoryCache::load() {
+    struct stat info{};
+    if (::fstat(fd, &info) != 0) {
+        throw std::runtime_error(errnoText("cannot stat history cache", path));
+    }
+    std::string bytes(size_t(info.st_size), '\0');
+    size_t got = 0;
+    while (got < bytes.size()) {
+        ssize_t n = ::pread(fd, bytes.data() + got, bytes.size() - got, off_t(got));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        got += size_t(n);
+    }
+    bytes.resize(got);
+
+    size_t at = bytes.find('\n');
+    unsigned long long epoch = 0;
+    if (at == std::string::npos || bytes.compare(0, sizeof(headerTag) - 1, headerTag) != 0 ||
+        std::sscanf(bytes.c_str() + sizeof(headerTag) - 1, "%llu", &epoch) != 1) {
+        if (!rewrite()) {  // empty, foreign or torn header: start clean
+            throw std::runtime_error(errnoText("cannot write history cache", path));
+        }
+        return;
+    }
+    epoch_ = epoch;
+    ++at;
+
+    // Records up to the first one that doesn't parse (a torn append).
+    size_t goodEnd = at;
+    while (at < bytes.size()) {
+        size_t lineEnd = bytes.find('\n', at);
+        if (lineEnd == std::string::npos) {
+            break;
+        }
+        unsigned long long seq = 0;
+        unsigned long long length = 0;
+        std::string line = bytes.substr(at, lineEnd - at);
+        if (std::sscanf(line.c_str(), "%llu %llu", &seq, &length) != 2 || seq <= lastSeq() ||
+            lineEnd + 1 + length + 1 > bytes.size() || bytes[lineEnd + 1 + length] != '\n') {
+            break;
+        }
+        entries_.push_back({seq, bytes.substr(lineEnd + 1, length)});
+        if (entries_.size() > capacity) {
+            entries_.pop_front();
+        }
+        ++recordsOnDisk;
+        at = lineEnd + 1 + length + 1;
+        goodEnd = at;
+    }
+    // Drop the torn tail (or the excess) before appending after it.
+    if ((goodEnd != bytes.size() || recordsOnDisk >= 2 * capacity) && !rewrite()) {
+        throw std::runtime_error(errnoText("cannot write history cache", path));
+    }
+}
+
+bool HistoryCache::reset(uint64_t epoch) {
+    epoch_ = epoch;
+    entries_.clear();
+    pending.clear();
+    return rewrite();
+}
+
+void HistoryCache::append(uint64_t seq, std::string_view body) {
+    char header[48];
+    int length = std::snprintf(header, sizeof(header), "%llu %zu\n", (unsigned long long)seq, body.size());
+    pending.append(header, size_t(length));
+    pending.append(body);
+    pending.push_back('\n');
+
+    entries_.push_back({seq, std::string(body)});
+    if (entries_.size() > capacity) {
+        entries_.pop_front();
+    }
+    ++recordsOnDisk;
+}
+
+bool HistoryCache::flush() {
+    if (pending.empty()) {
+        return true;
+    }
+    if (recordsOnDisk >= 2 * capacity) {
+        pending.clear();
+        return rewrite();  // entries_ already has them
+    }
+    std::string bytes;
+    bytes.swap(pending);
+    return ::lseek(fd, 0, SEEK_END) >= 0 && writeAll(bytes);
+}
+
+bool HistoryCache::rewrite() {
+    /*
+     * In place rather than write-a-copy-and-rename: a renamed file is a new
+     * inode my flock() doesn't cover, and a second client could lock it
+     * while I still write the old one.
+     */
+    std::string bytes = headerTag + std::to_string(epoch_) + "\n";
+    for (const Entry& entry : entries_) {
+        bytes += std::to_string(entry.seq) + " " + std::to_string(entry.body.size()) + "\n";
+        bytes += entry.body;
+        bytes += '\n';
+    }
+    recordsOnDisk = entries_.size();
+    return ::ftruncate(fd, 0) == 0 && ::lseek(fd, 0, SEEK_SET) >= 0 && writeAll(bytes);
+}
+
+bool HistoryCache::writeAll(const std::string& bytes) {
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        written += size_t(n);
+    }
+    return true;
+}
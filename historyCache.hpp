@@ -0,0 +1,95 @@
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#ifndef HISTORY_CACHE_HPP
+#define HISTORY_CACHE_HPP
+
+/*
+ * ============================================================================
+ * HISTORY CACHE - The room's recent history, kept on disk between runs
+ * ============================================================================
+ *
+ * RESUME already spares a reconnecting client the history it has seen -
+ * but only within one process. Start clientApp again five minutes later and
+ * it has no epoch and no seq, so Room::join replays all of it; restart the
+ * server's clients en masse and that is every client's full history at once.
+ *
+ * So I keep what I've shown in a file, keyed by the server's seq:
+ *
+ *   chat-history 1 <epoch>\n          header: whose numbering this is
+ *   <seq> <length>\n<body>\n          one record per chat frame, appended
+ *   <seq> <length>\n<body>\n
+ *   ...
+ *
+ * On startup the connection takes epoch and the last seq from here, shows
+ * the cached bodies, and RESUMEs from that seq - the server replays only
+ * the delta. A different epoch means a restarted server: everything here
+ * is dropped and the file starts over.
+ *
+ * Writes: append() only buffers; flush() writes the buffer in one write(),
+ * once per batch of frames read rather than once per frame. When the file
+ * holds twice `capacity` records it is rewritten with the newest ones.
+ *
+ * A crash mid-write leaves a torn last record; load stops at the first
+ * record that doesn't parse, keeping everything before it. It's a cache -
+ * losing the tail just means the server replays a little more.
+ *
+ * One client per file: the constructor takes an exclusive flock() and
+ * throws if another process holds it.
+ * ============================================================================
+ */
+
+class HistoryCache {
+public:
+    struct Entry {
+        uint64_t seq;
+        std::string body;
+    };
+
+    static constexpr size_t defaultCapacity = 50;  // Room keeps 50 too
+
+    // Opens (creating if needed), locks and loads. Throws on failure.
+    explicit HistoryCache(const std::string& path, size_t capacity = defaultCapacity);
+    ~HistoryCache();
+
+    HistoryCache(const HistoryCache&) = delete;
+    HistoryCache& operator=(const HistoryCache&) = delete;
+
+    uint64_t epoch() const { return epoch_; }
+    uint64_t lastSeq() const { return entries_.empty() ? 0 : entries_.back().seq; }
+    const std::deque<Entry>& entries() const { return entries_; }
+
+    /*
+     * Only the constructor throws. After that a failed write returns false
+     * and the caller should stop using the cache: the file no longer
+     * matches entries().
+     */
+
+    // A server with a different epoch: forget everything, numbering restarts.
+    bool reset(uint64_t epoch);
+
+    // Remember one delivered frame. seq must be above lastSeq().
+    void append(uint64_t seq, std::string_view body);
+
+    // Write what append() buffered.
+    bool flush();
+
+private:
+    void load();
+    bool rewrite();
+    bool writeAll(const std::string& bytes);
+
+    std::string path;
+    size_t capacity;
+    int fd = -1;
+
+    uint64_t epoch_ = 0;
+    std::deque<Entry> entries_;
+    size_t recordsOnDisk = 0;  // including ones already trimmed from entries_
+    std::string pending;
+};
+
+#endif // HISTORY_CACHE_HPP
@@ -0,0 +1,89 @@
+#include <boost/asio.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifndef IO_POOL_HPP
+#define IO_POOL_HPP
+
+/*
+ * ============================================================================
+ * IO POOL - One io_context per worker thread
+ * ============================================================================
+ *
+ * Why not one io_context with N threads calling run()?
+ *   - Handlers for the same socket could run on any thread, so every Session
+ *     would need a strand and every handler would bounce between cores
+ *   - One context per thread keeps a Session's whole life on one core:
+ *     its reads, its writes, its inbox drain - no strand needed
+ *
+ * Sessions are handed out round-robin via next(). Anything that wants to
+ * reach a Session from another thread goes through the Session's executor
+ * (see Session::deliver()).
+ *
+ * The work guards keep idle workers alive while there are no connections.
+ * ============================================================================
+ */
+
+class IoPool {
+public:
+    explicit IoPool(size_t count) {
+        if (count == 0) {
+            count = 1;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+            guards.push_back(boost::asio::make_work_guard(*contexts.back()));
+        }
+    }
+
+    IoPool(const IoPool&) = delete;
+    IoPool& operator=(const IoPool&) = delete;
+
+    ~IoPool() {
+        stop();
+        join();
+    }
+
+    void start() {
+        for (auto& context : contexts) {
+            threads.emplace_back([ctx = context.get()]() { ctx->run(); });
+        }
+    }
+
+    void stop() {
+        guards.clear();
+        for (auto& context : contexts) {
+            context->stop();
+        }
+    }
+
+    void join() {
+        for (auto& thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        threads.clear();
+    }
+
+    // Round-robin. Relaxed is fine - we only want a rough spread.
+    boost::asio::io_context& next() {
+        size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return *contexts[index % contexts.size()];
+    }
+
+    boost::asio::io_context& at(size_t index) { return *contexts[index]; }
+    size_t size() const { return contexts.size(); }
+
+private:
+    using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+    std::vector<WorkGuard> guards;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextIndex{0};
+};
+
+#endif // IO_POOL_HPP
@@ -0,0 +1,110 @@
+#include "listener.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+
+// ============================================================================
+// SERVER INFRASTRUCTURE - Accepting connections
+// ============================================================================
+
+Listener::Listener(boost::asio::io_context& acceptIo, const Endpoint& endpoint,
+                   Room& room, IoPool& workers, const ServerConfig& config)
+    : acceptor(acceptIo, endpoint),
+      room(room),
+      workers(workers),
+      pendingAccepts(config.pendingAccepts),
+      acceptBatch(config.acceptBatch),
+      sessionOptions(config.session) {
+    /*
+     * Non-blocking mode only affects the synchronous accept() calls in
+     * drainBacklog(): they return would_block instead of parking the
+     * acceptor thread. async_accept() doesn't care either way.
+     */
+    acceptor.non_blocking(true);
+}
+
+void Listener::start() {
+    /*
+     * I need to continuously accept new connections. But accept() is blocking -
+     * it waits until someone connects.
+     *
+     * async_accept() is non-blocking. It says "when someone connects, call
+     * this function" and returns immediately.
+     *
+     * Several of them at once, so one slow completion doesn't hold up the
+     * next connection in the backlog.
+     */
+    for (size_t i = 0; i < pendingAccepts; ++i) {
+        acceptOne();
+    }
+}
+
+void Listener::stop() {
+    boost::system::error_code ignored;
+    acceptor.close(ignored);
+}
+
+void Listener::acceptOne() {
+    /*
+     * The accepted socket comes back already bound to the worker that will
+     * own the Session. Round-robin at accept time is good enough spreading;
+     * connections are long-lived and roughly uniform.
+     */
+    acceptor.async_accept(workers.next(),
+        [this](boost::system::error_code ec, StreamSocket socket) {
+            if (!ec) {
+                onboard(std::move(socket));
+                drainBacklog();
+            } else if (ec == boost::asio::error::operation_aborted) {
+                return;  // stop() closed the acceptor - end this chain
+            } else {
+                LOG_ERROR("Accept error: {}", ec.message());
+                ServerMetrics::get().acceptErrors.inc();
+            }
+
+            /*
+             * Keep accepting more connections. This recursive call creates
+             * an endless loop of accepts. Each success triggers another
+             * async_accept().
+             */
+            acceptOne();
+        });
+}
+
+void Listener::drainBacklog() {
+    /*
+     * A burst of SYNs means more connections are already sitting in the
+     * kernel's accept queue. Grab them now rather than paying a reactor
+     * round-trip per connection. Bounded so a storm can't starve whatever
+     * else runs on the accept thread.
+     */
+    for (size_t i = 0; i < acceptBatch; ++i) {
+        boost::system::error_code ec;
+        StreamSocket socket = acceptor.accept(workers.next(), ec);
+        if (ec) {
+            if (ec != boost::asio::error::would_block && ec != boost::asio::error::try_again) {
+                LOG_ERROR("Accept error: {}", ec.message());
+                ServerMetrics::get().acceptErrors.inc();
+            }
+            return;
+        }
+        onboard(std::move(socket));
+    }
+}
+
+void Listener::onboard(StreamSocket socket) {
+    /*
+     * Someone connected! Wrap their socket in a Session object and start
+     * participating in the chat.
+     *
+     * start() joins the Room and issues the first read, so it has to run on
+     * the Session's own worker thread - post it there instead of calling it
+     * from the accept thread.
+     */
+    auto session = std::make_shared<Session>(std::move(socket), room, sessionOptions);
+    accepted.fetch_add(1, std::memory_order_relaxed);
+    ServerMetrics::get().connectionsAccepted.inc();
+
+    boost::asio::post(session->executor(), [session]() { session->start(); });
+
+    LOG_INFO("New client connected");
+}
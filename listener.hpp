@@ -0,0 +1,70 @@
+#include "chatRoom.hpp"
+#include "ioPool.hpp"
+#include "serverConfig.hpp"
+#include <atomic>
+#include <cstdint>
+
+#ifndef LISTENER_HPP
+#define LISTENER_HPP
+
+/*
+ * ============================================================================
+ * LISTENER - Getting connections off the backlog and onto a worker
+ * ============================================================================
+ *
+ * The original start_accept() kept exactly ONE async_accept() in flight and
+ * heap-allocated a shared_ptr<tcp::socket> for each one. Fine for a handful
+ * of friends. Then a deploy restarts the server and 20k clients reconnect at
+ * once: every connection waits for the previous accept's callback to run,
+ * re-arm, and go back through the reactor. The listen backlog fills up and
+ * the kernel starts dropping SYNs.
+ *
+ * What changed:
+ *
+ *   1. Several accepts in flight (config.pendingAccepts). Each is an
+ *      independent chain, so completions can overlap.
+ *
+ *   2. Drain the backlog. When an accept completes, there are usually more
+ *      connections already queued in the kernel. A non-blocking accept()
+ *      loop pulls up to config.acceptBatch of them without another trip
+ *      through the event loop, stopping at would_block.
+ *
+ *   3. Move-accept straight onto a worker. async_accept(workerIo, ...)
+ *      hands back a socket already bound to the worker's io_context - no
+ *      shared_ptr<tcp::socket>, no re-registration afterwards.
+ *
+ * The acceptor itself runs on the main io_context; Sessions never do.
+ *
+ * The acceptor is protocol-generic, so the same class serves the TCP port
+ * and the optional Unix domain socket (--unix).
+ * ============================================================================
+ */
+
+class Listener {
+public:
+    using Endpoint = boost::asio::generic::stream_protocol::endpoint;
+
+    Listener(boost::asio::io_context& acceptIo, const Endpoint& endpoint,
+             Room& room, IoPool& workers, const ServerConfig& config);
+
+    void start();
+    void stop();
+
+    Endpoint localEndpoint() const { return acceptor.local_endpoint(); }
+    uint64_t acceptedCount() const { return accepted.load(std::memory_order_relaxed); }
+
+private:
+    void acceptOne();
+    void drainBacklog();
+    void onboard(StreamSocket socket);
+
+    boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol> acceptor;
+    Room& room;
+    IoPool& workers;
+    size_t pendingAccepts;
+    size_t acceptBatch;
+    SessionOptions sessionOptions;
+    std::atomic<uint64_t> accepted{0};
+};
+
+#endif // LISTENER_HPP
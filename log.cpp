@@ -0,0 +1,414 @@
+#include "log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <cerrno>
+#include <unistd.h>
+
+// ============================================================================
+// LOGGING - Per-thread rings and the formatter thread
+// ============================================================================
+
+/*
+ * Single-producer (the owning thread) / single-consumer (the formatter)
+ * ring of fixed-size records. Same head/tail scheme as the shared-memory
+ * ring, just with whole slots instead of bytes.
+ */
+class LogRing {
+public:
+    static const size_t capacity = 4096;  // 512 KiB per logging thread
+
+    explicit LogRing(uint32_t index) : index(index), slots(new LogRecord[capacity]) {}
+
+    LogRecord* claim() {
+        /*
+         * The producer keeps its own copy of `tail` and only re-reads the
+         * shared one when that copy says the ring is full - otherwise every
+         * log call would pull the formatter's cache line over.
+         */
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - cachedTail == capacity) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h - cachedTail == capacity) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &slots[h & (capacity - 1)];
+    }
+
+    void publish() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const LogRecord* peek() const {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[t & (capacity - 1)];
+    }
+
+    void release() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const uint32_t index;
+    std::atomic<uint64_t> dropped{0};
+    uint64_t droppedReported = 0;  // formatter thread only
+
+private:
+    alignas(64) std::atomic<uint64_t> head{0};
+    uint64_t cachedTail = 0;  // producer only
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::unique_ptr<LogRecord[]> slots;
+};
+
+namespace {
+
+/*
+ * Rings are registered on a thread's first log call and never freed until
+ * the process exits: a thread that logs once and exits leaves 512 KiB
+ * behind. The server's threads are the io pool plus main, so that's fine
+ * and it means the formatter never races a ring's destruction.
+ */
+std::mutex registryMutex;
+std::vector<std::unique_ptr<LogRing>> rings;
+thread_local LogRing* currentRing = nullptr;
+
+std::mutex wakeMutex;
+std::condition_variable wake;
+std::thread formatter;
+std::atomic<bool> running{false};
+int outputFd = STDOUT_FILENO;
+
+// Every site the formatter has printed; formatter thread only.
+std::unordered_set<LogSite*> seenSites;
+
+LogRing* ringForThisThread() {
+    if (currentRing == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        rings.push_back(std::make_unique<LogRing>(static_cast<uint32_t>(rings.size())));
+        currentRing = rings.back().get();
+    }
+    return currentRing;
+}
+
+uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+void appendTimestamp(std::string& out, uint64_t ns) {
+    /*
+     * localtime_r() isn't cheap; consecutive records are almost always in
+     * the same second, so the formatted date/time prefix is cached.
+     */
+    static time_t cachedSecond = -1;
+    static char cachedPrefix[32];
+
+    time_t seconds = static_cast<time_t>(ns / 1000000000ull);
+    if (seconds != cachedSecond) {
+        struct tm parts;
+        localtime_r(&seconds, &parts);
+        std::strftime(cachedPrefix, sizeof(cachedPrefix), "%Y-%m-%d %H:%M:%S", &parts);
+        cachedSecond = seconds;
+    }
+    char micros[16];
+    std::snprintf(micros, sizeof(micros), ".%06u", static_cast<unsigned>((ns / 1000) % 1000000));
+    out += cachedPrefix;
+    out += micros;
+}
+
+// Decode the next argument from a record's payload onto `out`.
+size_t appendArg(std::string& out, const LogRecord& record, size_t offset) {
+    auto type = static_cast<LogRecord::ArgType>(record.payload[offset]);
+    const char* value = record.payload + offset + 1;
+    char number[32];
+
+    switch (type) {
+    case LogRecord::Int: {
+        int64_t v;
+        std::memcpy(&v, value, sizeof(v));
+        std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(v));
+        out += number;
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::UInt: {
+        uint64_t v;
+        std::memcpy(&v, value, sizeof(v));
+        std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(v));
+        out += number;
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::Double: {
+        double v;
+        std::memcpy(&v, value, sizeof(v));
+        std::snprintf(number, sizeof(number), "%g", v);
+        out += number;
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::Bool: {
+        bool v;
+        std::memcpy(&v, value, sizeof(v));
+        out += v ? "true" : "false";
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::String: {
+        size_t length = static_cast<uint8_t>(value[0]);
+        out.append(value + 1, length);
+        return offset + 2 + length;
+    }
+    }
+    return record.used;  // unknown tag - stop decoding
+}
+
+void format(std::string& out, const LogRecord& record, uint32_t threadIndex) {
+    const LogSite& site = *record.site;
+
+    appendTimestamp(out, record.timestampNs);
+    out += ' ';
+    const char* name = logLevelName(site.level);
+    out += name;
+    out.append(6 - std::strlen(name), ' ');
+    out += "[t";
+    out += std::to_string(threadIndex);
+    out += "] ";
+
+    size_t offset = 0;
+    unsigned remaining = record.argCount;
+    for (const char* p = site.format; *p != '\0'; ++p) {
+        if (p[0] == '{' && p[1] == '}' && remaining > 0) {
+            offset = appendArg(out, record, offset);
+            --remaining;
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+
+    if (record.truncated) {
+        out += " (truncated)";
+    }
+    if (record.suppressed > 0) {
+        out += " (+";
+        out += std::to_string(record.suppressed);
+        out += " suppressed)";
+    }
+    out += '\n';
+}
+
+void flush(std::string& buffer) {
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = ::write(outputFd, buffer.data() + done, buffer.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;  // nowhere to log to - drop rather than spin
+        }
+        done += static_cast<size_t>(n);
+    }
+    buffer.clear();
+}
+
+size_t drainOnce(std::string& buffer) {
+    std::vector<LogRing*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& ring : rings) {
+            snapshot.push_back(ring.get());
+        }
+    }
+
+    /*
+     * Rings are drained one after another, so lines from different threads
+     * are not globally time-ordered - each thread's own lines are. The
+     * timestamps tell the real story when it matters.
+     */
+    size_t drained = 0;
+    for (LogRing* ring : snapshot) {
+        while (const LogRecord* record = ring->peek()) {
+            seenSites.insert(record->site);
+            format(buffer, *record, ring->index);
+            ring->release();
+            ++drained;
+            if (buffer.size() > 64 * 1024) {
+                flush(buffer);
+            }
+        }
+
+        uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped != ring->droppedReported) {
+            appendTimestamp(buffer, wallClockNs());
+            buffer += " WARN  [t" + std::to_string(ring->index) + "] logger: " +
+                      std::to_string(dropped - ring->droppedReported) + " records dropped (ring full)\n";
+            ring->droppedReported = dropped;
+        }
+    }
+    flush(buffer);
+    return drained;
+}
+
+void flushSuppressed(std::string& buffer, bool all) {
+    /*
+     * A suppressed count normally rides along on the site's next record.
+     * If the storm just stops there IS no next record, so once a second
+     * (and at shutdown) report leftovers from sites whose window has
+     * closed. Any site that can be suppressing has already printed, so
+     * seenSites covers them all.
+     */
+    int64_t second = static_cast<int64_t>(wallClockNs() / 1000000000ull);
+    for (LogSite* site : seenSites) {
+        if (site->suppressed.load(std::memory_order_relaxed) == 0 ||
+            (!all && site->windowSecond.load(std::memory_order_relaxed) >= second)) {
+            continue;
+        }
+        uint32_t count = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        appendTimestamp(buffer, wallClockNs());
+        const char* name = logLevelName(site->level);
+        buffer += ' ';
+        buffer += name;
+        buffer.append(6 - std::strlen(name), ' ');
+        buffer += "[log] \"";
+        buffer += site->format;
+        buffer += "\" (+" + std::to_string(count) + " suppressed)\n";
+    }
+    flush(buffer);
+}
+
+void formatterLoop() {
+    std::string buffer;
+    buffer.reserve(128 * 1024);
+    auto lastSweep = std::chrono::steady_clock::now();
+
+    /*
+     * Poll rather than have producers signal: a notify per log call would
+     * put a syscall (futex wake) straight back on the hot path. An idle
+     * 5 ms sleep costs nothing measurable and bounds the display latency.
+     */
+    for (;;) {
+        bool stopping = !running.load(std::memory_order_acquire);
+        size_t drained = drainOnce(buffer);
+        if (stopping) {
+            flushSuppressed(buffer, true);
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep >= std::chrono::seconds(1)) {
+            flushSuppressed(buffer, false);
+            lastSweep = now;
+        }
+        if (drained == 0) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(5),
+                          [] { return !running.load(std::memory_order_acquire); });
+        }
+    }
+}
+
+} // namespace
+
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO";
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    case LogLevel::Off: return "OFF";
+    }
+    return "?";
+}
+
+bool parseLogLevel(std::string_view text, LogLevel& level) {
+    static const LogLevel all[] = {LogLevel::Debug, LogLevel::Info, LogLevel::Warn,
+                                   LogLevel::Error, LogLevel::Off};
+    for (LogLevel candidate : all) {
+        std::string_view name = logLevelName(candidate);
+        if (text.size() == name.size() &&
+            std::equal(text.begin(), text.end(), name.begin(),
+                       [](char a, char b) { return std::toupper(static_cast<unsigned char>(a)) == b; })) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+LogRecord* Logger::begin(LogSite& site) {
+    uint64_t now = wallClockNs();
+
+    /*
+     * Per-site rate limit over one-second windows. The window reset is a
+     * benign race: two threads crossing the boundary together may both
+     * reset, letting a handful of extra records through. Cheaper than a
+     * CAS loop, and exactness doesn't matter here.
+     */
+    uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+    if (limit != 0) {
+        int64_t second = static_cast<int64_t>(now / 1000000000ull);
+        if (site.windowSecond.load(std::memory_order_relaxed) != second) {
+            site.windowSecond.store(second, std::memory_order_relaxed);
+            site.windowCount.store(0, std::memory_order_relaxed);
+        }
+        if (site.windowCount.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    LogRecord* record = ringForThisThread()->claim();
+    if (record == nullptr) {
+        return nullptr;
+    }
+    record->site = &site;
+    record->timestampNs = now;
+    record->suppressed = site.suppressed.load(std::memory_order_relaxed) != 0
+                             ? site.suppressed.exchange(0, std::memory_order_relaxed)
+                             : 0;
+    record->used = 0;
+    record->argCount = 0;
+    record->truncated = 0;
+    return record;
+}
+
+void Logger::commit() {
+    currentRing->publish();
+}
+
+void Logger::start(int fd) {
+    if (running.exchange(true)) {
+        return;
+    }
+    outputFd = fd;
+    formatter = std::thread(formatterLoop);
+}
+
+void Logger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    wake.notify_all();
+    formatter.join();
+}
+
+uint64_t Logger::droppedCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t total = 0;
+    for (auto& ring : rings) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,196 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifndef LOG_HPP
+#define LOG_HPP
+
+/*
+ * ============================================================================
+ * LOGGING - Getting std::cout off the io threads
+ * ============================================================================
+ *
+ * Every connect, disconnect and error used to do
+ *
+ *     std::cout << "Client disconnected" << std::endl;
+ *
+ * from whichever io thread noticed. std::endl flushes, so that's a write()
+ * syscall per line, and std::cout is shared, so io threads queue up behind
+ * each other on its lock. During a disconnect storm (a NAT box dropping
+ * 5k connections at once) the event loops spent more time printing than
+ * closing sockets.
+ *
+ * What a log call does now:
+ *
+ *   1. Level check - one relaxed load. Below the threshold, the arguments
+ *      aren't even evaluated (it's a macro).
+ *   2. Rate limit - per call site, at most N records per second. The rest
+ *      are counted, and the count rides along on the next record that does
+ *      get through ("... (+1234 suppressed)").
+ *   3. Encode - the call site pointer, a timestamp and the raw argument
+ *      values are copied into a fixed 128-byte record in THIS thread's
+ *      ring. No formatting, no allocation, no locks, no syscalls.
+ *
+ * A background thread walks all the rings, formats the records and writes
+ * them out in large batches. If a ring is full the record is dropped and
+ * counted - the hot path never waits for the logger.
+ *
+ * Usage:
+ *
+ *   LOG_INFO("New client connected");
+ *   LOG_WARN("Read error: {}", ec.message());
+ *
+ * `{}` placeholders are filled in order. Arguments may be integers,
+ * floating point, bools, or anything string-like (strings are truncated
+ * to what fits in the record).
+ * ============================================================================
+ */
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+const char* logLevelName(LogLevel level);
+bool parseLogLevel(std::string_view text, LogLevel& level);
+
+/*
+ * One of these per LOG_* statement (a function-local static the macro
+ * declares). It's what a record points back to, and where that statement's
+ * rate-limit window lives.
+ */
+struct LogSite {
+    LogLevel level;
+    const char* format;
+    const char* file;
+    int line;
+
+    std::atomic<int64_t> windowSecond{-1};
+    std::atomic<uint32_t> windowCount{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+/*
+ * The binary record. Arguments are packed into `payload` as a type tag
+ * followed by the raw value (strings: one length byte, then the bytes).
+ */
+struct LogRecord {
+    enum ArgType : uint8_t { Int, UInt, Double, Bool, String };
+
+    static const size_t size = 128;
+
+    LogSite* site;
+    uint64_t timestampNs;
+    uint32_t suppressed;
+    uint16_t used;
+    uint8_t argCount;
+    uint8_t truncated;
+    char payload[size - 24];
+};
+static_assert(sizeof(LogRecord) == LogRecord::size, "LogRecord must stay one 128-byte slot");
+
+class LogRing;
+
+class Logger {
+public:
+    static bool enabled(LogLevel level) {
+        return level >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    static void setLevel(LogLevel level) { minLevel.store(level, std::memory_order_relaxed); }
+
+    // Records per second per call site; 0 disables rate limiting.
+    static void setRateLimit(uint32_t perSecond) { rateLimit.store(perSecond, std::memory_order_relaxed); }
+
+    /*
+     * Spawn / join the formatter thread. Records logged before start() sit
+     * in their rings (until full); stop() drains everything still queued.
+     */
+    static void start(int fd);
+    static void stop();
+
+    // Total records dropped because a ring was full.
+    static uint64_t droppedCount();
+
+    template <typename... Args>
+    static void write(LogSite& site, const Args&... args) {
+        LogRecord* record = begin(site);
+        if (record == nullptr) {
+            return;
+        }
+        (encode(*record, args), ...);
+        commit();
+    }
+
+private:
+    static LogRecord* begin(LogSite& site);
+    static void commit();
+
+    static void put(LogRecord& record, LogRecord::ArgType type, const void* bytes, size_t length) {
+        if (record.truncated || size_t(record.used) + 1 + length > sizeof(record.payload)) {
+            record.truncated = 1;
+            return;
+        }
+        record.payload[record.used] = static_cast<char>(type);
+        std::memcpy(record.payload + record.used + 1, bytes, length);
+        record.used = static_cast<uint16_t>(record.used + 1 + length);
+        ++record.argCount;
+    }
+
+    static void putString(LogRecord& record, std::string_view text) {
+        if (record.truncated || size_t(record.used) + 2 > sizeof(record.payload)) {
+            record.truncated = 1;
+            return;
+        }
+        size_t room = sizeof(record.payload) - record.used - 2;
+        size_t length = text.size() < room ? text.size() : room;
+        if (length > 255) {
+            length = 255;
+        }
+        record.payload[record.used] = static_cast<char>(LogRecord::String);
+        record.payload[record.used + 1] = static_cast<char>(static_cast<uint8_t>(length));
+        std::memcpy(record.payload + record.used + 2, text.data(), length);
+        record.used = static_cast<uint16_t>(record.used + 2 + length);
+        ++record.argCount;
+    }
+
+    template <typename T>
+    static void encode(LogRecord& record, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            put(record, LogRecord::Bool, &value, sizeof(value));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            int64_t wide = value;
+            put(record, LogRecord::Int, &wide, sizeof(wide));
+        } else if constexpr (std::is_integral_v<T>) {
+            uint64_t wide = value;
+            put(record, LogRecord::UInt, &wide, sizeof(wide));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double wide = value;
+            put(record, LogRecord::Double, &wide, sizeof(wide));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            putString(record, std::string_view(value));
+        } else {
+            static_assert(std::is_convertible_v<const T&, std::string_view>,
+                          "LOG_* arguments must be numbers, bools or string-like");
+        }
+    }
+
+    static inline std::atomic<LogLevel> minLevel{LogLevel::Info};
+    static inline std::atomic<uint32_t> rateLimit{20};
+};
+
+#define CHAT_LOG(lvl, fmt, ...)                                                  \
+    do {                                                                         \
+        if (Logger::enabled(lvl)) {                                              \
+            static LogSite chatLogSite_{lvl, fmt, __FILE__, __LINE__};           \
+            Logger::write(chatLogSite_ __VA_OPT__(, ) __VA_ARGS__);              \
+        }                                                                        \
+    } while (0)
+
+#define LOG_DEBUG(...) CHAT_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) CHAT_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) CHAT_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) CHAT_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif // LOG_HPP
@@ -0,0 +1,165 @@
+#include "memoryLedger.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+// ============================================================================
+// MEMORY LEDGER - Accounts, the /top report and budget enforcement
+// ============================================================================
+
+MemoryAccount::MemoryAccount(const char* kind) : kind(kind) {
+    MemoryLedger::global().open(this);
+}
+
+MemoryAccount::~MemoryAccount() {
+    MemoryLedger::global().close(this);
+}
+
+void MemoryAccount::setLabel(const std::string& text) {
+    std::lock_guard<std::mutex> lock(MemoryLedger::global().mutex);
+    label = text;
+}
+
+void MemoryAccount::setEvict(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lock(MemoryLedger::global().mutex);
+    evict = std::move(fn);
+}
+
+MemoryLedger& MemoryLedger::global() {
+    static MemoryLedger ledger;
+    return ledger;
+}
+
+void MemoryLedger::open(MemoryAccount* account) {
+    account->id_ = nextId.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.emplace(account->id_, account);
+}
+
+void MemoryLedger::close(MemoryAccount* account) {
+    std::lock_guard<std::mutex> lock(mutex);
+    accounts.erase(account->id_);
+}
+
+namespace {
+
+MemoryLedger::Usage usageOf(const MemoryAccount& account, const char* kind, const std::string& label) {
+    return {account.id(), kind, label,
+            account.queued.load(std::memory_order_relaxed),
+            account.buffers.load(std::memory_order_relaxed),
+            account.history.load(std::memory_order_relaxed)};
+}
+
+} // namespace
+
+int64_t MemoryLedger::total() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t sum = 0;
+    for (const auto& entry : accounts) {
+        const MemoryAccount& account = *entry.second;
+        sum += account.queued.load(std::memory_order_relaxed) +
+               account.buffers.load(std::memory_order_relaxed) +
+               account.history.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::vector<MemoryLedger::Usage> MemoryLedger::top(size_t count) const {
+    std::vector<Usage> usages;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        usages.reserve(accounts.size());
+        for (const auto& entry : accounts) {
+            usages.push_back(usageOf(*entry.second, entry.second->kind, entry.second->label));
+        }
+    }
+    std::sort(usages.begin(), usages.end(),
+              [](const Usage& a, const Usage& b) { return a.total() > b.total(); });
+    if (usages.size() > count) {
+        usages.resize(count);
+    }
+    return usages;
+}
+
+std::string MemoryLedger::report(size_t count, int64_t budget) const {
+    std::vector<Usage> all = top(SIZE_MAX);
+    int64_t sum = 0;
+    for (const Usage& usage : all) {
+        sum += usage.total();
+    }
+
+    std::ostringstream out;
+    out << "accounted " << sum << " bytes in " << all.size() << " accounts, budget ";
+    if (budget > 0) {
+        out << budget << " bytes";
+    } else {
+        out << "off";
+    }
+    out << "\n\n";
+    out << std::left << std::setw(8) << "id" << std::setw(9) << "kind" << std::setw(28) << "label"
+        << std::right << std::setw(12) << "queued" << std::setw(12) << "buffers"
+        << std::setw(12) << "history" << std::setw(12) << "total" << "\n";
+    for (size_t i = 0; i < all.size() && i < count; ++i) {
+        const Usage& usage = all[i];
+        out << std::left << std::setw(8) << usage.id << std::setw(9) << usage.kind
+            << std::setw(28) << usage.label << std::right << std::setw(12) << usage.queued
+            << std::setw(12) << usage.buffers << std::setw(12) << usage.history
+            << std::setw(12) << usage.total() << "\n";
+    }
+    return out.str();
+}
+
+bool MemoryLedger::evict(uint64_t id, const char* reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = accounts.find(id);
+    if (found == accounts.end() || !found->second->evict) {
+        return false;
+    }
+    const MemoryAccount& account = *found->second;
+    LOG_WARN("Evicting {} {} ({} bytes queued): {}", account.kind, account.label,
+             account.queued.load(std::memory_order_relaxed), reason);
+    ServerMetrics::get().memoryEvictions.inc();
+    account.evict();
+    return true;
+}
+
+size_t MemoryLedger::enforce(int64_t budget) {
+    if (budget <= 0) {
+        return 0;
+    }
+    int64_t excess = total() - budget;
+    if (excess <= 0) {
+        return 0;
+    }
+
+    struct Candidate {
+        uint64_t id;
+        int64_t queued;
+    };
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : accounts) {
+            int64_t queued = entry.second->queued.load(std::memory_order_relaxed);
+            if (entry.second->evict && queued > 0) {
+                candidates.push_back({entry.first, queued});
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.queued > b.queued; });
+
+    size_t evicted = 0;
+    for (const Candidate& candidate : candidates) {
+        if (excess <= 0) {
+            break;
+        }
+        if (evict(candidate.id, "memory budget exceeded")) {
+            excess -= candidate.queued;
+            ++evicted;
+        }
+    }
+    return evicted;
+}
@@ -0,0 +1,120 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef MEMORY_LEDGER_HPP
+#define MEMORY_LEDGER_HPP
+
+/*
+ * ============================================================================
+ * MEMORY LEDGER - Who is holding the server's memory?
+ * ============================================================================
+ *
+ * RSS going up tells me something is queued somewhere. It doesn't tell me
+ * whether that's one client on a dead Wi-Fi link with 40k frames behind
+ * it, or the history, or everyone a little. So every Session, ShmSession
+ * and Room carries a MemoryAccount: a few relaxed atomics the owner bumps
+ * on paths it already runs (deliver, write completion, history push/pop).
+ *
+ *   queued    frames waiting to be written, at what each one pins: its
+ *             queue node plus the shared Frame. A frame shared by 100
+ *             slow readers is counted 100 times - but it's also kept alive
+ *             by whichever of them is slowest, which is the one I want
+ *             to see at the top.
+ *   buffers   the owner's own footprint: the object, its batching vectors,
+ *             shared-memory rings
+ *   history   a Room's replay window
+ *
+ * The ledger is the list of live accounts. Its mutex is taken on account
+ * open/close (session start/end), by the admin /top report and by the
+ * budget check - never per frame.
+ *
+ * Budget: if the accounted total passes --memory-budget, enforce() evicts
+ * sessions with the most queued bytes until the projected total fits. An
+ * evicted Session is closed on its own executor, exactly as if its write
+ * had timed out. Better to drop the worst offender than have the OOM
+ * killer drop everyone.
+ * ============================================================================
+ */
+
+class MemoryAccount {
+public:
+    // Registers with MemoryLedger::global(); unregisters on destruction.
+    explicit MemoryAccount(const char* kind);
+    ~MemoryAccount();
+
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    uint64_t id() const { return id_; }
+
+    // Shown in /top. Set once the owner knows it (e.g. the peer address).
+    void setLabel(const std::string& label);
+
+    /*
+     * How to get rid of this account's owner. Called under the ledger lock
+     * from the admin thread, so it must only post work, never block.
+     * Accounts without one are reported but never evicted.
+     */
+    void setEvict(std::function<void()> evict);
+
+    std::atomic<int64_t> queued{0};
+    std::atomic<int64_t> buffers{0};
+    std::atomic<int64_t> history{0};
+
+private:
+    friend class MemoryLedger;
+
+    uint64_t id_;
+    const char* kind;
+    std::string label;
+    std::function<void()> evict;
+};
+
+class MemoryLedger {
+public:
+    static MemoryLedger& global();
+
+    struct Usage {
+        uint64_t id;
+        std::string kind;
+        std::string label;
+        int64_t queued;
+        int64_t buffers;
+        int64_t history;
+        int64_t total() const { return queued + buffers + history; }
+    };
+
+    int64_t total() const;
+
+    // Largest first, by total.
+    std::vector<Usage> top(size_t count) const;
+
+    // Plain-text report for the admin endpoint.
+    std::string report(size_t count, int64_t budget) const;
+
+    bool evict(uint64_t id, const char* reason);
+
+    /*
+     * Over budget → evict by queued bytes, largest first, until the
+     * projected total fits. Returns how many were evicted.
+     */
+    size_t enforce(int64_t budget);
+
+private:
+    friend class MemoryAccount;
+
+    void open(MemoryAccount* account);
+    void close(MemoryAccount* account);
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, MemoryAccount*> accounts;
+    std::atomic<uint64_t> nextId{1};
+};
+
+#endif // MEMORY_LEDGER_HPP
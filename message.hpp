@@ -1,5 +1,7 @@
+#include <utility>  // must precede asio: boost 1.74 awaitable.hpp uses std::exchange
 #include <boost/asio.hpp>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <cstdio>
 #include <stdexcept>
@@ -165,6 +167,66 @@ public:
         return std::string(data + header, bodyLength_);
     }
 
+    // ========================================================================
+    // CONTROL FRAMES - Protocol Housekeeping
+    // ========================================================================
+
+    /*
+     * Some frames aren't chat at all: heartbeats, and whatever else the
+     * server and client need to say to each other. Rather than change the
+     * header format, a control frame is an ordinary frame whose body starts
+     * with the ASCII SOH byte (0x01), which nobody types into a chat:
+     *
+     *   [  5][\x01PING]            verb only
+     *   [ 13][\x01PONG 12345]      verb + space + arguments
+     *
+     * Control frames are consumed by the receiving end and never broadcast.
+     * Unknown verbs are ignored, so either side can add new ones without
+     * breaking the other.
+     *
+     * Flow control is one of them. "CREDIT <n>" lets the other side send n
+     * more CHAT frames (control frames never need credit); grants add up,
+     * and a side that has been granted nothing yet is unlimited - which is
+     * what an old peer that never heard of CREDIT gets. The receiver counts
+     * what it has taken in and hands that back, typically every half window:
+     *
+     *   client → server   [  11][\x01CREDIT 256]   "send me up to 256 ahead"
+     *   server → client   [  10][\x01CREDIT 64]    "...and you up to 64"
+     *
+     * A sender out of credit queues instead of writing. Both counts start at
+     * the connection: chat frames sent before the first grant count too.
+     * chatApp only takes part with --flow-window; otherwise it ignores a
+     * client's CREDIT.
+     */
+    static const char controlMarker = '\x01';
+
+    static Message control(const std::string& verb, const std::string& args = "") {
+        std::string body(1, controlMarker);
+        body += verb;
+        if (!args.empty()) {
+            body += ' ';
+            body += args;
+        }
+        return Message(body);
+    }
+
+    bool isControl() const {
+        return bodyLength_ > 0 && data[header] == controlMarker;
+    }
+
+    // "PING" for "\x01PING 42". Only meaningful when isControl().
+    std::string_view controlVerb() const {
+        std::string_view body(data + header + 1, bodyLength_ - 1);
+        return body.substr(0, body.find(' '));
+    }
+
+    // "42" for "\x01PING 42", empty if there are no arguments.
+    std::string_view controlArgs() const {
+        std::string_view body(data + header + 1, bodyLength_ - 1);
+        size_t space = body.find(' ');
+        return space == std::string_view::npos ? std::string_view() : body.substr(space + 1);
+    }
+
     // ========================================================================
     // UTILITY FUNCTIONS - Support Operations
     // ========================================================================
@@ -0,0 +1,256 @@
+#include "metrics.hpp"
+#include "egress.hpp"
+#include "log.hpp"
+#include "memoryLedger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+// ============================================================================
+// METRICS - Registry, exposition and the server's metric set
+// ============================================================================
+
+size_t metricShard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % maxMetricShards;
+    return shard;
+}
+
+Histogram::Histogram(std::vector<uint64_t> upperBounds) : bounds(std::move(upperBounds)) {
+    shards.reserve(maxMetricShards);
+    for (size_t i = 0; i < maxMetricShards; ++i) {
+        shards.push_back(std::make_unique<Shard>(bounds.size() + 1));
+    }
+}
+
+void Histogram::collect(std::vector<uint64_t>& counts, uint64_t& sum) const {
+    counts.assign(bounds.size() + 1, 0);
+    sum = 0;
+    for (const auto& shard : shards) {
+        for (size_t b = 0; b < counts.size(); ++b) {
+            counts[b] += shard->buckets[b].load(std::memory_order_relaxed);
+        }
+        sum += shard->sum.load(std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::LatencyHistogram() {
+    shards.reserve(maxMetricShards);
+    for (size_t i = 0; i < maxMetricShards; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    snap.counts.assign(bucketCount, 0);
+    for (const auto& shard : shards) {
+        for (size_t b = 0; b < bucketCount; ++b) {
+            snap.counts[b] += shard->buckets[b].load(std::memory_order_relaxed);
+        }
+        snap.sum += shard->sum.load(std::memory_order_relaxed);
+        snap.max = std::max(snap.max, shard->max.load(std::memory_order_relaxed));
+    }
+    for (uint64_t c : snap.counts) {
+        snap.count += c;
+    }
+    return snap;
+}
+
+uint64_t LatencyHistogram::Snapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(q * double(count))));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); ++b) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return std::min(bucketUpper(b), max);
+        }
+    }
+    return max;
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::add(const std::string& name, const std::string& help,
+                                             const char* type, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.emplace_back();
+    Entry& entry = entries.back();
+    entry.name = name;
+    entry.help = help;
+    entry.type = type;
+    entry.labels = labels;
+    return entry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    Entry& entry = add(name, help, "counter", labels);
+    entry.counter = std::make_unique<Counter>();
+    return *entry.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    Entry& entry = add(name, help, "gauge", labels);
+    entry.gauge = std::make_unique<Gauge>();
+    return *entry.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      std::vector<uint64_t> upperBounds, const std::string& labels) {
+    Entry& entry = add(name, help, "histogram", labels);
+    entry.histogram = std::make_unique<Histogram>(std::move(upperBounds));
+    return *entry.histogram;
+}
+
+LatencyHistogram& MetricsRegistry::latency(const std::string& name, const std::string& help,
+                                           const std::string& labels) {
+    Entry& entry = add(name, help, "summary", labels);
+    entry.latency = std::make_unique<LatencyHistogram>();
+    return *entry.latency;
+}
+
+void MetricsRegistry::callback(const std::string& name, const std::string& help, const char* type,
+                               std::function<double()> read, const std::string& labels) {
+    Entry& entry = add(name, help, type, labels);
+    entry.read = std::move(read);
+}
+
+namespace {
+
+std::string withLabels(const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) {
+        return "";
+    }
+    if (labels.empty() || extra.empty()) {
+        return "{" + labels + extra + "}";
+    }
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string number(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    return text;
+}
+
+} // namespace
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream out;
+    std::string lastName;
+
+    for (const Entry& entry : entries) {
+        if (entry.name != lastName) {
+            out << "# HELP " << entry.name << " " << entry.help << "\n";
+            out << "# TYPE " << entry.name << " " << entry.type << "\n";
+            lastName = entry.name;
+        }
+
+        if (entry.counter) {
+            out << entry.name << withLabels(entry.labels) << " " << entry.counter->value() << "\n";
+        } else if (entry.gauge) {
+            out << entry.name << withLabels(entry.labels) << " " << entry.gauge->value() << "\n";
+        } else if (entry.histogram) {
+            std::vector<uint64_t> counts;
+            uint64_t sum = 0;
+            entry.histogram->collect(counts, sum);
+            const auto& bounds = entry.histogram->upperBounds();
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b < counts.size(); ++b) {
+                cumulative += counts[b];
+                std::string le = b < bounds.size() ? std::to_string(bounds[b]) : "+Inf";
+                out << entry.name << "_bucket" << withLabels(entry.labels, "le=\"" + le + "\"")
+                    << " " << cumulative << "\n";
+            }
+            out << entry.name << "_sum" << withLabels(entry.labels) << " " << sum << "\n";
+            out << entry.name << "_count" << withLabels(entry.labels) << " " << cumulative << "\n";
+        } else if (entry.latency) {
+            LatencyHistogram::Snapshot snap = entry.latency->snapshot();
+            static const struct { const char* label; double q; } quantiles[] = {
+                {"0.5", 0.5}, {"0.99", 0.99}, {"0.999", 0.999}, {"1", 1.0}};
+            for (const auto& quantile : quantiles) {
+                out << entry.name << withLabels(entry.labels, std::string("quantile=\"") + quantile.label + "\"")
+                    << " " << number(double(snap.quantile(quantile.q)) / 1e9) << "\n";
+            }
+            out << entry.name << "_sum" << withLabels(entry.labels) << " " << number(double(snap.sum) / 1e9) << "\n";
+            out << entry.name << "_count" << withLabels(entry.labels) << " " << snap.count << "\n";
+        } else if (entry.read) {
+            out << entry.name << withLabels(entry.labels) << " " << number(entry.read()) << "\n";
+        }
+    }
+    return out.str();
+}
+
+/*
+ * Entries render in registration order and HELP/TYPE is emitted when the
+ * name changes, so metrics sharing a name are registered next to each other.
+ */
+ServerMetrics::ServerMetrics()
+    : connectionsAccepted(MetricsRegistry::global().counter(
+          "chat_connections_accepted_total", "Connections handed to a Session.")),
+      acceptErrors(MetricsRegistry::global().counter(
+          "chat_accept_errors_total", "accept() failures other than would_block.")),
+      sessionsActive(MetricsRegistry::global().gauge(
+          "chat_sessions_active", "Sessions currently alive.")),
+      muxChannels(MetricsRegistry::global().gauge(
+          "chat_mux_channels_active", "Channels open on multiplexed connections, each a Room participant.")),
+      framesIn(MetricsRegistry::global().counter(
+          "chat_frames_in_total", "Frames received from clients, control frames included.")),
+      bytesIn(MetricsRegistry::global().counter(
+          "chat_bytes_in_total", "Bytes received from clients, headers included.")),
+      broadcasts(MetricsRegistry::global().counter(
+          "chat_broadcasts_total", "Messages passed to Room::deliver().")),
+      deliveries(MetricsRegistry::global().counter(
+          "chat_deliveries_total", "Per-recipient copies queued by Room::deliver().")),
+      outboundQueued(MetricsRegistry::global().gauge(
+          "chat_outbound_queued_frames", "Frames queued for sockets and not yet written.")),
+      framesOut(MetricsRegistry::global().counter(
+          "chat_frames_out_total", "Frames written to client sockets.")),
+      bytesOut(MetricsRegistry::global().counter(
+          "chat_bytes_out_total", "Bytes written to client sockets.")),
+      writeBatchFrames(MetricsRegistry::global().histogram(
+          "chat_write_batch_frames", "Frames per gathered socket write.",
+          {1, 2, 4, 8, 16, 32, 64})),
+      readErrors(MetricsRegistry::global().counter(
+          "chat_errors_total", "Session errors by kind.", "kind=\"read\"")),
+      writeErrors(MetricsRegistry::global().counter(
+          "chat_errors_total", "Session errors by kind.", "kind=\"write\"")),
+      protocolErrors(MetricsRegistry::global().counter(
+          "chat_errors_total", "Session errors by kind.", "kind=\"protocol\"")),
+      timeouts(MetricsRegistry::global().counter(
+          "chat_errors_total", "Session errors by kind.", "kind=\"timeout\"")),
+      memoryEvictions(MetricsRegistry::global().counter(
+          "chat_memory_evictions_total", "Sessions closed to get back under --memory-budget.")),
+      resumes(MetricsRegistry::global().counter(
+          "chat_resumes_total", "Reconnects that resumed from a seq instead of replaying all history.")),
+      flowBacklogged(MetricsRegistry::global().gauge(
+          "chat_flow_backlogged_sessions", "Sessions with more than --flow-window frames queued.")),
+      readPauses(MetricsRegistry::global().counter(
+          "chat_flow_read_pauses_total", "Times a session stopped reading because the room was congested.")),
+      fanoutLatency(MetricsRegistry::global().latency(
+          "chat_fanout_latency_seconds",
+          "Sender's read completing to each recipient's write completing, all rooms.")) {
+    MetricsRegistry& registry = MetricsRegistry::global();
+    const EgressStats& egress = EgressStats::global();
+    registry.callback("chat_tcp_segments_total", "Data segments sent (TCP_INFO, sampled).", "counter",
+                      [&egress]() { return double(egress.tcpSegments.load(std::memory_order_relaxed)); });
+    registry.callback("chat_coalesce_holds_total", "Batches held back by the coalescing window.", "counter",
+                      [&egress]() { return double(egress.held.load(std::memory_order_relaxed)); });
+    registry.callback("chat_log_dropped_total", "Log records dropped because a ring was full.", "counter",
+                      []() { return double(Logger::droppedCount()); });
+    registry.callback("chat_memory_accounted_bytes", "Bytes held by sessions and rooms (see /top).", "gauge",
+                      []() { return double(MemoryLedger::global().total()); });
+}
+
+ServerMetrics& ServerMetrics::get() {
+    static ServerMetrics metrics;
+    return metrics;
+}
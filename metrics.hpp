@@ -0,0 +1,289 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+/*
+ * ============================================================================
+ * METRICS - Counting things without making the io threads fight over it
+ * ============================================================================
+ *
+ * The obvious counter is one std::atomic<uint64_t> that every thread does
+ * fetch_add() on. It's correct, and it's a cache line ping-ponging between
+ * cores on every message: with four io threads all bumping "frames out",
+ * that line is the hottest thing in the process.
+ *
+ * So every metric here is SHARDED: each thread gets a shard index the
+ * first time it touches any metric, and only ever writes its own
+ * cache-line-sized slot. Writers never share a line (up to maxShards
+ * threads), so the relaxed fetch_add stays core-local.
+ *
+ * Reading is the slow side on purpose: a scrape sums all shards. Sums are
+ * not a point-in-time snapshot across shards, which Prometheus doesn't
+ * expect anyway.
+ *
+ *   Counter     monotonic, inc(n)
+ *   Gauge       up and down, add(+/-n) - the sum of shards is the value
+ *   Histogram   fixed upper bounds, observe(v); cumulative buckets on export
+ *   LatencyHistogram
+ *               log-linear buckets, record(ns); exported as quantiles
+ *
+ * Metrics are created once (startup) through MetricsRegistry and live
+ * forever; hot paths keep references. The registry's mutex covers
+ * registration and scraping only - never inc()/observe().
+ * ============================================================================
+ */
+
+static const size_t maxMetricShards = 64;
+
+// This thread's shard, assigned round-robin on first use.
+size_t metricShard();
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) {
+        shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards[maxMetricShards];
+};
+
+class Gauge {
+public:
+    void add(int64_t n) {
+        shards[metricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    int64_t value() const {
+        int64_t total = 0;
+        for (const auto& shard : shards) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+    Shard shards[maxMetricShards];
+};
+
+class Histogram {
+public:
+    explicit Histogram(std::vector<uint64_t> upperBounds);
+
+    void observe(uint64_t value) {
+        Shard& shard = *shards[metricShard()];
+        size_t bucket = 0;
+        while (bucket < bounds.size() && value > bounds[bucket]) {
+            ++bucket;
+        }
+        shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    const std::vector<uint64_t>& upperBounds() const { return bounds; }
+
+    // Per-bucket (non-cumulative) counts, last one is +Inf; plus the sum.
+    void collect(std::vector<uint64_t>& counts, uint64_t& sum) const;
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(size_t buckets) : buckets(new std::atomic<uint64_t>[buckets]()) {}
+        std::atomic<uint64_t> sum{0};
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    };
+
+    std::vector<uint64_t> bounds;
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+/*
+ * HDR-style log-linear histogram for latencies. Fixed bounds are fine for
+ * "frames per write", but a latency spans microseconds to seconds and the
+ * interesting part is the tail - a p99.9 read off a handful of hand-picked
+ * buckets is mostly guesswork.
+ *
+ * So every power of two gets 2^subBucketBits linear sub-buckets: values
+ * below 32ns are exact, everything above is within 1/32 (~3%) of the
+ * truth, whatever the magnitude. Up to 2^41ns (~36 minutes) that's 1184
+ * buckets; anything longer lands in the last one. Recording is an index
+ * computation and two relaxed adds on this thread's shard.
+ *
+ * Exported as a Prometheus summary (p50/p99/p99.9, plus quantile="1" for
+ * the max), in seconds. Quantiles report a bucket's upper edge, clamped to
+ * the observed max, so they never under-state.
+ */
+class LatencyHistogram {
+public:
+    static const unsigned subBucketBits = 5;
+    static const unsigned maxExponent = 40;
+    static const size_t subBuckets = size_t(1) << subBucketBits;
+    static const size_t bucketCount = subBuckets * (maxExponent - subBucketBits + 2);
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos) {
+        Shard& shard = *shards[metricShard()];
+        shard.buckets[bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t seen = shard.max.load(std::memory_order_relaxed);
+        while (nanos > seen && !shard.max.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    static size_t bucketFor(uint64_t nanos) {
+        if (nanos < subBuckets) {
+            return nanos;
+        }
+        unsigned exponent = 63 - __builtin_clzll(nanos);
+        if (exponent > maxExponent) {
+            return bucketCount - 1;
+        }
+        unsigned shift = exponent - subBucketBits;
+        return (shift + 1) * subBuckets + ((nanos >> shift) & (subBuckets - 1));
+    }
+
+    // Largest value that maps to `bucket`.
+    static uint64_t bucketUpper(size_t bucket) {
+        if (bucket < subBuckets) {
+            return bucket;
+        }
+        unsigned shift = unsigned(bucket / subBuckets) - 1;
+        uint64_t lower = (subBuckets + bucket % subBuckets) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+    // All shards merged; quantile() works on the copy.
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        uint64_t quantile(double q) const;
+    };
+
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::atomic<uint64_t> buckets[bucketCount] = {};
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+/*
+ * Name → metric, plus the text exposition. Same name with different label
+ * sets is fine (e.g. chat_errors_total{kind="read"} / {kind="write"});
+ * HELP/TYPE are printed once per name.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         std::vector<uint64_t> upperBounds, const std::string& labels = "");
+    LatencyHistogram& latency(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    /*
+     * A value computed at scrape time, for numbers that already live
+     * somewhere else (EgressStats, the logger). The function runs on the
+     * scraping thread, so it must be lock-free with respect to hot paths.
+     */
+    void callback(const std::string& name, const std::string& help, const char* type,
+                  std::function<double()> read, const std::string& labels = "");
+
+    // Prometheus text format, version 0.0.4.
+    std::string render() const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::unique_ptr<LatencyHistogram> latency;
+        std::function<double()> read;
+    };
+
+    Entry& add(const std::string& name, const std::string& help, const char* type, const std::string& labels);
+
+    mutable std::mutex mutex;
+    std::deque<Entry> entries;
+};
+
+/*
+ * The server's own metrics, registered on first use. Kept in one place so
+ * the full list is easy to find.
+ */
+struct ServerMetrics {
+    static ServerMetrics& get();
+
+    Counter& connectionsAccepted;
+    Counter& acceptErrors;
+    Gauge& sessionsActive;
+    Gauge& muxChannels;
+
+    Counter& framesIn;
+    Counter& bytesIn;
+
+    Counter& broadcasts;
+    Counter& deliveries;
+    Gauge& outboundQueued;
+
+    Counter& framesOut;
+    Counter& bytesOut;
+    Histogram& writeBatchFrames;
+
+    Counter& readErrors;
+    Counter& writeErrors;
+    Counter& protocolErrors;
+    Counter& timeouts;
+
+    Counter& memoryEvictions;
+
+    // RESUMEs that matched the room's epoch and skipped part of the history.
+    Counter& resumes;
+
+    // Flow control: recipients over --flow-window, and read loops paused for them.
+    Gauge& flowBacklogged;
+    Counter& readPauses;
+
+    // Every room together; each Room also keeps its own (Room::fanoutLatency).
+    LatencyHistogram& fanoutLatency;
+
+private:
+    ServerMetrics();
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,109 @@
+#include <atomic>
+
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+/*
+ * ============================================================================
+ * MPSC QUEUE - Lock-free Multi-Producer Single-Consumer Inbox
+ * ============================================================================
+ *
+ * Purpose: Lets any thread hand a node to a Session without taking a lock,
+ *          while only the Session's own executor ever takes nodes out.
+ *
+ * Why not std::deque + std::mutex?
+ *   - Every Room::deliver() on every thread would contend on the same lock
+ *   - A producer could block behind a consumer that is busy popping
+ *   - The consumer side is already serialized by the executor, so half of
+ *     the mutex's job is wasted work
+ *
+ * The design (Dmitry Vyukov's intrusive MPSC queue):
+ *
+ *   push():  one atomic exchange on head_, then link the previous node.
+ *            Wait-free for producers - no loops, no CAS retries.
+ *
+ *   pop():   consumer walks from tail_ following next pointers. A permanent
+ *            stub node means the queue is never truly "null", which removes
+ *            every special case around the last element.
+ *
+ *   ┌──────┐   ┌──────┐   ┌──────┐
+ *   │ stub │──▶│ msgA │──▶│ msgB │◀── head_ (producers exchange here)
+ *   └──────┘   └──────┘   └──────┘
+ *      ▲
+ *      └── tail_ (only the consumer touches this)
+ *
+ * The one subtle case: a producer has exchanged head_ but not yet linked
+ * prev->next. For that short window pop() returns nullptr even though a node
+ * is on the way. That's fine for us - the producer still has to flip the
+ * Session's "writing" flag afterwards, and that is what schedules the drain.
+ *
+ * Intrusive: nodes derive from MpscNode, so the queue never allocates.
+ * Ownership of popped nodes passes to the consumer.
+ * ============================================================================
+ */
+
+struct MpscNode {
+    std::atomic<MpscNode*> next{nullptr};
+};
+
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread. Never blocks.
+    void push(MpscNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only. Returns nullptr when empty (or a push is mid-flight).
+    MpscNode* pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+
+        // tail is the last linked node. If a producer is between its
+        // exchange and its link, back off and let the flag handshake retry.
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        // Re-insert the stub behind the last node so it can be handed out.
+        push(&stub_);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+    // Consumer only. A fully linked node is always visible here.
+    bool empty() const {
+        return tail_ == &stub_ && stub_.next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    alignas(64) std::atomic<MpscNode*> head_;   // producers' end
+    alignas(64) MpscNode* tail_;                // consumer's end
+    MpscNode stub_;
+};
+
+#endif // MPSC_QUEUE_HPP
@@ -0,0 +1,23 @@
+#include "muxChannel.hpp"
+#include "metrics.hpp"
+
+// ============================================================================
+// MUX CHANNEL - One logical participant riding a multiplexed Session
+// ============================================================================
+
+MuxChannel::MuxChannel(std::shared_ptr<Session> carrier, Room& room, uint32_t id)
+    : carrier(std::move(carrier)), room(room), id_(id) {
+    ServerMetrics::get().muxChannels.add(1);
+}
+
+MuxChannel::~MuxChannel() {
+    ServerMetrics::get().muxChannels.add(-1);
+}
+
+void MuxChannel::deliver(const FramePtr& frame) {
+    carrier->deliverOnChannel(id_, frame);
+}
+
+void MuxChannel::write(Message& msg) {
+    room.deliver(shared_from_this(), makeFrame(msg, Frame::Clock::now()));
+}
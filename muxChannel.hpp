@@ -0,0 +1,50 @@
+#include "chatRoom.hpp"
+#include <cstdint>
+#include <memory>
+
+#ifndef MUX_CHANNEL_HPP
+#define MUX_CHANNEL_HPP
+
+/*
+ * ============================================================================
+ * MUX CHANNEL - A Room participant that shares someone else's connection
+ * ============================================================================
+ *
+ * A gateway fronting thousands of end users used to need a socket per user,
+ * because a Session IS one participant. After "MUX" a Session stops being a
+ * participant and carries channels instead; each one is this object, joined
+ * to the Room on its own (own seat, own history replay, not echoed its own
+ * messages) but with no socket, no write chain and no timers of its own:
+ *
+ *   deliver():  hand the frame to the carrying Session, tagged with my id.
+ *               Its write chain batches my frames with everyone else's and
+ *               writes a broadcast ONCE for all its channels - see
+ *               Session::flushBatch().
+ *
+ *   write():    the Session attributes an inbound chat frame to me ("CH"
+ *               just before it) and I broadcast it as myself.
+ *
+ * The wire side is all in Session (startMux(), openChannel() and friends).
+ * The Session holds me and I hold it; Session::close() leaves the Room for
+ * every channel and drops them, which breaks the cycle.
+ * ============================================================================
+ */
+
+class MuxChannel : public Participant, public std::enable_shared_from_this<MuxChannel> {
+public:
+    MuxChannel(std::shared_ptr<Session> carrier, Room& room, uint32_t id);
+    ~MuxChannel();
+
+    using Participant::deliver;
+    void deliver(const FramePtr& frame) override;
+    void write(Message& msg) override;
+
+    uint32_t id() const { return id_; }
+
+private:
+    std::shared_ptr<Session> carrier;
+    Room& room;
+    const uint32_t id_;
+};
+
+#endif // MUX_CHANNEL_HPP
@@ -0,0 +1,239 @@
+#include "listener.hpp"
+#include "adminServer.hpp"
+#include "egress.hpp"
+#include "memoryLedger.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
+#include "metrics.hpp"
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+
+int main(int argc, char* argv[]) {
+    /*
+     * Server startup. The pattern:
+     * 1. Create the core objects (Room, io_contexts, listener)
+     * 2. Start accepting connections
+     * 3. Run the event loops
+     *
+     * Everything happens inside run() - that's where the async magic lives.
+     */
+
+    ServerConfig config;
+    try {
+        config = parseServerArgs(argc, argv);
+    } catch (std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::cerr << "Usage: " << argv[0] << " " << serverUsage() << "\n";
+        return 1;
+    }
+
+    /*
+     * Everything after this point logs through the async logger; only the
+     * usage error above goes straight to stderr.
+     */
+    Logger::setLevel(config.logLevel);
+    Logger::setRateLimit(static_cast<uint32_t>(config.logRate));
+    Logger::start(STDOUT_FILENO);
+    int status = 0;
+
+    try {
+        /*
+         * The foundation objects:
+         * - Room: coordinates all the chat participants
+         * - io: the accept loop (and, later, housekeeping) lives here
+         * - workers: one io_context per thread; Sessions live here
+         * - listener: listens for incoming connections
+         *
+         * Declaration order matters on the way out: the Room drops its
+         * Sessions (and their sockets) before the worker contexts those
+         * sockets belong to are destroyed.
+         */
+        IoPool workers(config.ioThreads);
+        Room room;
+        boost::asio::io_context io(1);
+        tcp::endpoint endpoint(tcp::v4(), config.port);
+        Listener listener(io, endpoint, room, workers, config);
+
+        LOG_INFO("Chat server listening on port {} ({} io threads, {} pending accepts)",
+                 config.port, workers.size(), config.pendingAccepts);
+
+        /*
+         * Metrics are registered up front so the first scrape already lists
+         * every series, even ones that haven't moved yet.
+         */
+        ServerMetrics::get();
+        std::unique_ptr<AdminServer> admin;
+        if (config.adminPort != 0) {
+            admin = std::make_unique<AdminServer>(io, config.adminPort);
+            admin->route("/metrics", [](const AdminServer::Query&) {
+                return AdminServer::Response{"text/plain; version=0.0.4; charset=utf-8",
+                                             MetricsRegistry::global().render()};
+            });
+            // /top?n=20 - biggest memory holders; /evict?id=N - close one of them.
+            admin->route("/top", [&config](const AdminServer::Query& query) {
+                auto n = query.find("n");
+                size_t count = n != query.end() ? std::strtoul(n->second.c_str(), nullptr, 10) : 20;
+                return AdminServer::Response{"text/plain; charset=utf-8",
+                                             MemoryLedger::global().report(count ? count : 20,
+                                                                           int64_t(config.memoryBudget))};
+            });
+            admin->route("/evict", [](const AdminServer::Query& query) {
+                auto id = query.find("id");
+                bool done = id != query.end() &&
+                            MemoryLedger::global().evict(std::strtoull(id->second.c_str(), nullptr, 10),
+                                                         "evicted from the admin endpoint");
+                return AdminServer::Response{"text/plain; charset=utf-8",
+                                             done ? "evicting\n" : "no such evictable account\n"};
+            });
+            LOG_INFO("Admin endpoint on http://127.0.0.1:{}/metrics", admin->port());
+        }
+
+        /*
+         * Local clients (bots, bridges) can skip TCP entirely. A stale
+         * socket file from a previous run would make bind() fail, so it's
+         * removed first - and again on the way out.
+         */
+        std::unique_ptr<Listener> localListener;
+        if (!config.unixPath.empty()) {
+            ::unlink(config.unixPath.c_str());
+            localListener = std::make_unique<Listener>(
+                io, boost::asio::local::stream_protocol::endpoint(config.unixPath),
+                room, workers, config);
+            LOG_INFO("Also listening on {}", config.unixPath);
+        }
+
+        std::unique_ptr<Watchdog> watchdog;
+
+        /*
+         * Ctrl-C / SIGTERM: stop accepting, stop the workers, unwind
+         * normally so destructors run.
+         */
+        boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+        signals.async_wait([&](boost::system::error_code, int) {
+            listener.stop();
+            if (localListener) {
+                localListener->stop();
+            }
+            if (admin) {
+                admin->stop();
+            }
+            if (watchdog) {
+                watchdog->stop();
+            }
+            workers.stop();
+            io.stop();
+        });
+
+        /*
+         * Optional periodic egress summary - the quickest way to see whether
+         * --coalesce-us / --cork are buying anything on a given workload.
+         */
+        boost::asio::steady_timer statsTimer(io);
+        std::function<void()> reportStats = [&]() {
+            statsTimer.expires_after(std::chrono::seconds(config.statsInterval));
+            statsTimer.async_wait([&](boost::system::error_code ec) {
+                if (ec) {
+                    return;
+                }
+                const EgressStats& stats = EgressStats::global();
+                uint64_t writes = stats.writes.load(std::memory_order_relaxed);
+                uint64_t segments = stats.tcpSegments.load(std::memory_order_relaxed);
+                LOG_INFO("egress: writes={} frames/write={} held={} bytes/segment={}",
+                         writes, writes ? double(stats.frames.load()) / writes : 0.0,
+                         stats.held.load(std::memory_order_relaxed),
+                         segments ? double(stats.tcpBytes.load()) / segments : 0.0);
+                LatencyHistogram::Snapshot fanout = ServerMetrics::get().fanoutLatency.snapshot();
+                LOG_INFO("fan-out latency us: p50={} p99={} p99.9={} max={} (n={})",
+                         fanout.quantile(0.5) / 1000, fanout.quantile(0.99) / 1000,
+                         fanout.quantile(0.999) / 1000, fanout.max / 1000, fanout.count);
+                reportStats();
+            });
+        };
+        if (config.statsInterval > 0) {
+            reportStats();
+        }
+
+        /*
+         * --memory-budget: once a second, here on the accept thread. The
+         * ledger only posts the evictions; each Session closes itself on
+         * its own worker.
+         */
+        boost::asio::steady_timer budgetTimer(io);
+        std::function<void()> checkBudget = [&]() {
+            budgetTimer.expires_after(std::chrono::seconds(1));
+            budgetTimer.async_wait([&](boost::system::error_code ec) {
+                if (ec) {
+                    return;
+                }
+                MemoryLedger::global().enforce(static_cast<int64_t>(config.memoryBudget));
+                checkBudget();
+            });
+        };
+        if (config.memoryBudget > 0) {
+            checkBudget();
+        }
+
+        // Sampled spans are buffered by the io threads; the file is written here.
+        Tracer::configure(config.traceSample, config.traceFile);
+        boost::asio::steady_timer traceTimer(io);
+        std::function<void()> flushTrace = [&]() {
+            traceTimer.expires_after(std::chrono::seconds(1));
+            traceTimer.async_wait([&](boost::system::error_code ec) {
+                if (ec) {
+                    return;
+                }
+                Tracer::flush();
+                flushTrace();
+            });
+        };
+        if (config.traceSample > 0) {
+            LOG_INFO("Tracing 1 in {} messages to {}", config.traceSample, config.traceFile);
+            flushTrace();
+        }
+
+        // --stall-budget: a thread outside the loops, heartbeating into each.
+        if (config.stallBudgetMs > 0) {
+            watchdog = std::make_unique<Watchdog>(std::chrono::milliseconds(config.stallBudgetMs));
+            watchdog->watch("accept", io);
+            for (size_t i = 0; i < workers.size(); ++i) {
+                watchdog->watch("worker-" + std::to_string(i), workers.at(i));
+            }
+            watchdog->start();
+            LOG_INFO("Watching {} event loops, stall budget {}ms", workers.size() + 1, config.stallBudgetMs);
+        }
+
+        workers.start();
+        listener.start();
+        if (localListener) {
+            localListener->start();
+        }
+        if (admin) {
+            admin->start();
+        }
+
+        /*
+         * Run the accept loop on this thread. Each worker runs its own loop:
+         *
+         * - New connections arrive → Listener hands them to a worker
+         * - Data arrives from clients → parse into Messages
+         * - Messages need broadcasting → Room fans out to all participants
+         * - Clients disconnect → clean up Sessions
+         */
+        io.run();
+        workers.join();
+
+        if (localListener) {
+            ::unlink(config.unixPath.c_str());
+        }
+
+    } catch (std::exception& e) {
+        LOG_ERROR("Error: {}", e.what());
+        status = 1;
+    }
+
+    Tracer::stop();
+    Logger::stop();
+    return status;
+}
@@ -0,0 +1,257 @@
+#include "log.hpp"
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstddef>
+#include <stdexcept>
+
+#ifndef SERVER_CONFIG_HPP
+#define SERVER_CONFIG_HPP
+
+/*
+ * ============================================================================
+ * SERVER CONFIG - Everything main() used to hard-code
+ * ============================================================================
+ *
+ * The server started life as "./chatApp <port>" and nothing else. Tuning
+ * knobs kept piling up (threads, accept fan-in, ...), so they live here
+ * instead of as loose locals in main().
+ *
+ * Command line:
+ *   ./chatApp <port> [--threads N] [--accepts N] [--accept-batch N]
+ *                    [--heartbeat S] [--idle-timeout S]
+ *                    [--read-timeout S] [--write-timeout S]
+ *                    [--coalesce-us N] [--coalesce-bytes N] [--cork]
+ *                    [--stats-interval S] [--unix PATH] [--shm-ring BYTES]
+ *                    [--mux-channels N] [--flow-window N] [--flow-stall S]
+ *                    [--log-level LEVEL] [--log-rate N] [--admin-port N]
+ *
+ * The positional port stays first so the old invocation keeps working.
+ * ============================================================================
+ */
+
+/*
+ * Per-Session liveness settings, in seconds on the command line. Zero turns
+ * a check off.
+ *
+ *   heartbeat     no inbound frame for this long → send a PING
+ *   idleTimeout   no inbound frame (PONG included) for this long → close
+ *   readTimeout   header arrived but the body hasn't for this long → close
+ *   writeTimeout  a single write has been in flight this long → close
+ */
+struct SessionOptions {
+    std::chrono::milliseconds heartbeat{std::chrono::seconds(15)};
+    std::chrono::milliseconds idleTimeout{std::chrono::seconds(45)};
+    std::chrono::milliseconds readTimeout{std::chrono::seconds(15)};
+    std::chrono::milliseconds writeTimeout{std::chrono::seconds(30)};
+
+    /*
+     * Egress write combining (see Session::flushBatch()).
+     *
+     *   coalesceWindow  during a burst, hold a batch up to this long (0 = off)
+     *   coalesceBytes   ...or until this many bytes are queued
+     *   cork            TCP_CORK while the queue is deep, uncork when drained
+     */
+    std::chrono::microseconds coalesceWindow{0};
+    size_t coalesceBytes = 16 * 1024;
+    bool cork = false;
+
+    /*
+     * Size of EACH shared-memory ring handed to a Unix-socket client that
+     * asks for the upgrade (see shmRing.hpp). Power of two; 0 refuses all
+     * upgrades.
+     */
+    size_t shmRingBytes = 1 << 20;
+
+    /*
+     * Channels one connection may carry after "MUX" (see muxChannel.hpp);
+     * each is a Room participant. 0 refuses multiplexing.
+     */
+    size_t muxChannels = 1024;
+
+    /*
+     * Frames a Session may have queued before the room stops reading from
+     * everyone else until it drains (see Session's flow-control notes).
+     * Also the CREDIT window granted to clients that ask. 0 = off.
+     *
+     * A Session that stays backlogged for flowStall is closed. This has its
+     * own bound rather than reusing writeTimeout: the whole room waits on
+     * it, and writeTimeout may be 0 or minutes long. Never 0.
+     */
+    size_t flowWindow = 0;
+    std::chrono::milliseconds flowStall{std::chrono::seconds(5)};
+};
+
+struct ServerConfig {
+    unsigned short port = 0;
+
+    // Worker io_contexts, one thread each. Sessions are spread across them.
+    size_t ioThreads = 1;
+
+    // How many async_accept() operations are kept in flight at once.
+    size_t pendingAccepts = 1;
+
+    // After an accept completes, how many more already-queued connections
+    // are pulled off the listen backlog synchronously before re-arming.
+    size_t acceptBatch = 64;
+
+    SessionOptions session;
+
+    // Print a one-line egress summary every N seconds (0 = never).
+    size_t statsInterval = 0;
+
+    // Also listen on this Unix domain socket path (empty = TCP only).
+    std::string unixPath;
+
+    // Minimum level written, and records per second per log statement
+    // before repeats are suppressed (0 = no limit). See log.hpp.
+    LogLevel logLevel = LogLevel::Info;
+    size_t logRate = 20;
+
+    // Local-only HTTP port for /metrics (0 = off). See adminServer.hpp.
+    unsigned short adminPort = 0;
+
+    // Accounted bytes (memoryLedger.hpp) above which the sessions with the
+    // most queued are evicted, checked once a second. 0 = no budget.
+    size_t memoryBudget = 0;
+
+    // Trace 1 in N messages into traceFile (0 = off). See trace.hpp.
+    size_t traceSample = 0;
+    std::string traceFile = "chat-trace.json";
+
+    // A loop whose heartbeat waits longer than this gets a stack sample
+    // (0 = no watchdog). See watchdog.hpp.
+    size_t stallBudgetMs = 0;
+};
+
+inline size_t parsePositive(const std::string& flag, const char* value) {
+    char* end = nullptr;
+    long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed <= 0) {
+        throw std::invalid_argument(flag + " expects a positive integer, got '" + value + "'");
+    }
+    return static_cast<size_t>(parsed);
+}
+
+inline size_t parseNonNegative(const std::string& flag, const char* value) {
+    char* end = nullptr;
+    long parsed = std::strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < 0) {
+        throw std::invalid_argument(flag + " expects a non-negative integer, got '" + value + "'");
+    }
+    return static_cast<size_t>(parsed);
+}
+
+inline std::chrono::milliseconds parseSeconds(const std::string& flag, const char* value) {
+    return std::chrono::seconds(parseNonNegative(flag, value));
+}
+
+/*
+ * parseServerArgs() - Throws std::invalid_argument on anything it doesn't
+ * understand; main() turns that into the usage message.
+ */
+inline ServerConfig parseServerArgs(int argc, char* argv[]) {
+    if (argc < 2) {
+        throw std::invalid_argument("missing <port>");
+    }
+
+    ServerConfig config;
+    size_t port = parsePositive("<port>", argv[1]);
+    if (port > 65535) {
+        throw std::invalid_argument("<port> out of range");
+    }
+    config.port = static_cast<unsigned short>(port);
+
+    for (int i = 2; i < argc; ++i) {
+        std::string flag = argv[i];
+
+        // Switches first - they don't take a value.
+        if (flag == "--cork") {
+            config.session.cork = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(flag + " is missing its value");
+        }
+        const char* value = argv[++i];
+
+        if (flag == "--threads") {
+            config.ioThreads = parsePositive(flag, value);
+        } else if (flag == "--accepts") {
+            config.pendingAccepts = parsePositive(flag, value);
+        } else if (flag == "--accept-batch") {
+            config.acceptBatch = parsePositive(flag, value);
+        } else if (flag == "--heartbeat") {
+            config.session.heartbeat = parseSeconds(flag, value);
+        } else if (flag == "--idle-timeout") {
+            config.session.idleTimeout = parseSeconds(flag, value);
+        } else if (flag == "--read-timeout") {
+            config.session.readTimeout = parseSeconds(flag, value);
+        } else if (flag == "--write-timeout") {
+            config.session.writeTimeout = parseSeconds(flag, value);
+        } else if (flag == "--coalesce-us") {
+            config.session.coalesceWindow = std::chrono::microseconds(parseNonNegative(flag, value));
+        } else if (flag == "--coalesce-bytes") {
+            config.session.coalesceBytes = parsePositive(flag, value);
+        } else if (flag == "--stats-interval") {
+            config.statsInterval = parseNonNegative(flag, value);
+        } else if (flag == "--unix") {
+            config.unixPath = value;
+            if (config.unixPath.empty()) {
+                throw std::invalid_argument("--unix expects a path");
+            }
+        } else if (flag == "--shm-ring") {
+            size_t bytes = parseNonNegative(flag, value);
+            if (bytes != 0 && (bytes < 4096 || (bytes & (bytes - 1)) != 0)) {
+                throw std::invalid_argument("--shm-ring must be 0 or a power of two >= 4096");
+            }
+            config.session.shmRingBytes = bytes;
+        } else if (flag == "--flow-window") {
+            config.session.flowWindow = parseNonNegative(flag, value);
+        } else if (flag == "--flow-stall") {
+            config.session.flowStall = std::chrono::seconds(parsePositive(flag, value));
+        } else if (flag == "--mux-channels") {
+            config.session.muxChannels = parseNonNegative(flag, value);
+        } else if (flag == "--log-level") {
+            if (!parseLogLevel(value, config.logLevel)) {
+                throw std::invalid_argument("--log-level expects debug, info, warn, error or off");
+            }
+        } else if (flag == "--log-rate") {
+            config.logRate = parseNonNegative(flag, value);
+        } else if (flag == "--admin-port") {
+            size_t adminPort = parseNonNegative(flag, value);
+            if (adminPort > 65535) {
+                throw std::invalid_argument("--admin-port out of range");
+            }
+            config.adminPort = static_cast<unsigned short>(adminPort);
+        } else if (flag == "--trace-sample") {
+            config.traceSample = parseNonNegative(flag, value);
+        } else if (flag == "--trace-file") {
+            config.traceFile = value;
+            if (config.traceFile.empty()) {
+                throw std::invalid_argument("--trace-file expects a path");
+            }
+        } else if (flag == "--memory-budget") {
+            config.memoryBudget = parseNonNegative(flag, value) * 1024 * 1024;
+        } else if (flag == "--stall-budget") {
+            config.stallBudgetMs = parseNonNegative(flag, value);
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    return config;
+}
+
+inline const char* serverUsage() {
+    return "<port> [--threads N] [--accepts N] [--accept-batch N]"
+           " [--heartbeat S] [--idle-timeout S] [--read-timeout S] [--write-timeout S]"
+           " [--coalesce-us N] [--coalesce-bytes N] [--cork] [--stats-interval S]"
+           " [--unix PATH] [--shm-ring BYTES] [--mux-channels N] [--flow-window N]"
+           " [--flow-stall S]"
+           " [--log-level LEVEL] [--log-rate N]"
+           " [--admin-port N] [--memory-budget MB] [--trace-sample N] [--trace-file PATH]"
+           " [--stall-budget MS]";
+}
+
+#endif // SERVER_CONFIG_HPP
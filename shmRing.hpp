@@ -0,0 +1,280 @@
+#include "message.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+/*
+ * ============================================================================
+ * SHARED-MEMORY RING - A transport for clients on the same host
+ * ============================================================================
+ *
+ * Bots and bridges running next to chatApp were still paying for TCP
+ * loopback: a syscall per write on both ends, a copy into the kernel and a
+ * copy back out, per message. For a high-volume local consumer that's most
+ * of the cost.
+ *
+ * So a local client can upgrade to a pair of byte rings in a memfd:
+ *
+ *   ┌──────────────┬──────────────┬─────────────────┬─────────────────┐
+ *   │ region hdr   │ ring ctl x2  │ server→client   │ client→server   │
+ *   │ magic, cap   │ head/tail/…  │ data (cap)      │ data (cap)      │
+ *   └──────────────┴──────────────┴─────────────────┴─────────────────┘
+ *
+ * Each ring is single-producer / single-consumer. The bytes in it are the
+ * SAME framing as the socket ("[len4][body]"), so Message does all the
+ * parsing and nothing upstream knows which transport a frame came from.
+ *
+ * Doorbells: one eventfd per side. A consumer with nothing to do sets its
+ * `consumerWaiting` flag and sleeps on its eventfd; a producer only rings
+ * (one write() syscall) when it sees that flag. Under load both sides stay
+ * busy and no doorbell syscalls happen at all. Same trick in reverse for a
+ * producer waiting on a full ring (`producerWaiting`).
+ *
+ * The memfd and both eventfds are handed to the client over the Unix domain
+ * socket with SCM_RIGHTS (see Session::completeUpgrade()).
+ * ============================================================================
+ */
+
+struct ShmRingControl {
+    alignas(64) std::atomic<uint64_t> head{0};            // bytes ever written (producer)
+    alignas(64) std::atomic<uint64_t> tail{0};            // bytes ever read (consumer)
+    alignas(64) std::atomic<uint32_t> consumerWaiting{0};
+    std::atomic<uint32_t> producerWaiting{0};
+};
+
+class ShmRing {
+public:
+    enum class ReadResult { Empty, Frame, Corrupt };
+
+    ShmRing(ShmRingControl* control, char* data, uint64_t capacity)
+        : control(control), data(data), capacity(capacity), mask(capacity - 1) {}
+
+    // ---- producer side ----------------------------------------------------
+
+    // Whole frame or nothing: a consumer never sees half a frame.
+    bool tryWrite(const char* bytes, size_t length) {
+        uint64_t head = control->head.load(std::memory_order_relaxed);
+        uint64_t tail = control->tail.load(std::memory_order_acquire);
+        if (capacity - (head - tail) < length) {
+            return false;
+        }
+        copyIn(head, bytes, length);
+        control->head.store(head + length, std::memory_order_seq_cst);
+        return true;
+    }
+
+    bool tryWrite(const Message& msg) {
+        return tryWrite(msg.data, Message::header + msg.getBodyLength());
+    }
+
+    // After publishing: does the consumer need its doorbell rung?
+    bool consumerNeedsWake() {
+        return control->consumerWaiting.exchange(0, std::memory_order_seq_cst) == 1;
+    }
+
+    // Before sleeping on a full ring. False means space appeared - retry.
+    bool armProducerWait(size_t needed) {
+        control->producerWaiting.store(1, std::memory_order_seq_cst);
+        if (freeSpace() >= needed) {
+            control->producerWaiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // ---- consumer side ----------------------------------------------------
+
+    ReadResult tryRead(Message& out) {
+        uint64_t tail = control->tail.load(std::memory_order_relaxed);
+        uint64_t head = control->head.load(std::memory_order_acquire);
+        if (head - tail > capacity) {
+            return ReadResult::Corrupt;  // the other side scribbled on the indices
+        }
+        if (head - tail < Message::header) {
+            return ReadResult::Empty;
+        }
+        copyOut(tail, out.data, Message::header);
+        if (!out.decodeHeader()) {
+            return ReadResult::Corrupt;
+        }
+        size_t length = Message::header + out.getBodyLength();
+        if (head - tail < length) {
+            return ReadResult::Corrupt;  // producers only publish whole frames
+        }
+        copyOut(tail + Message::header, out.data + Message::header, out.getBodyLength());
+        control->tail.store(tail + length, std::memory_order_seq_cst);
+        return ReadResult::Frame;
+    }
+
+    // After consuming: does a blocked producer need its doorbell rung?
+    bool producerNeedsWake() {
+        return control->producerWaiting.exchange(0, std::memory_order_seq_cst) == 1;
+    }
+
+    // Before sleeping on an empty ring. False means data appeared - retry.
+    bool armConsumerWait() {
+        control->consumerWaiting.store(1, std::memory_order_seq_cst);
+        if (control->head.load(std::memory_order_seq_cst) != control->tail.load(std::memory_order_relaxed)) {
+            control->consumerWaiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t freeSpace() const {
+        return capacity - (control->head.load(std::memory_order_acquire) -
+                           control->tail.load(std::memory_order_acquire));
+    }
+
+private:
+    void copyIn(uint64_t position, const char* bytes, size_t length) {
+        size_t offset = position & mask;
+        size_t first = std::min<size_t>(length, capacity - offset);
+        std::memcpy(data + offset, bytes, first);
+        std::memcpy(data, bytes + first, length - first);
+    }
+
+    void copyOut(uint64_t position, char* bytes, size_t length) const {
+        size_t offset = position & mask;
+        size_t first = std::min<size_t>(length, capacity - offset);
+        std::memcpy(bytes, data + offset, first);
+        std::memcpy(bytes + first, data, length - first);
+    }
+
+    ShmRingControl* control;
+    char* data;
+    uint64_t capacity;
+    uint64_t mask;
+};
+
+/*
+ * ShmRegion - owns the memfd mapping. The server create()s it; the client
+ * attach()es to the fd it received. Either way both rings are available,
+ * named from the server's point of view.
+ */
+class ShmRegion {
+public:
+    static const uint32_t magic = 0x43484d31;  // "CHM1"
+    static const uint64_t defaultCapacity = 1 << 20;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+    };
+
+    static std::unique_ptr<ShmRegion> create(uint64_t capacity) {
+        if (capacity < 4096 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("ring capacity must be a power of two >= 4096");
+        }
+        int fd = memfd_create("chat-shm", MFD_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("memfd_create: ") + std::strerror(errno));
+        }
+        size_t size = totalSize(capacity);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error(std::string("ftruncate: ") + std::strerror(err));
+        }
+        auto region = std::unique_ptr<ShmRegion>(new ShmRegion(fd, size));
+        new (region->base) Header{magic, 1, capacity};
+        new (region->controls()) ShmRingControl();
+        new (region->controls() + 1) ShmRingControl();
+        return region;
+    }
+
+    static std::unique_ptr<ShmRegion> attach(int fd) {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("shm region: bad fd");
+        }
+        auto region = std::unique_ptr<ShmRegion>(new ShmRegion(fd, static_cast<size_t>(info.st_size)));
+        const Header* header = static_cast<const Header*>(region->base);
+        if (header->magic != magic || header->capacity == 0 ||
+            (header->capacity & (header->capacity - 1)) != 0 ||
+            totalSize(header->capacity) != region->size) {
+            throw std::runtime_error("shm region: layout mismatch");
+        }
+        return region;
+    }
+
+    ~ShmRegion() {
+        if (base != MAP_FAILED) {
+            munmap(base, size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    ShmRegion(const ShmRegion&) = delete;
+    ShmRegion& operator=(const ShmRegion&) = delete;
+
+    int fileDescriptor() const { return fd; }
+    uint64_t capacity() const { return static_cast<const Header*>(base)->capacity; }
+
+    ShmRing serverToClient() { return ShmRing(controls(), dataStart(), capacity()); }
+    ShmRing clientToServer() { return ShmRing(controls() + 1, dataStart() + capacity(), capacity()); }
+
+private:
+    static size_t controlOffset() { return 64; }
+    static size_t dataOffset() { return controlOffset() + 2 * sizeof(ShmRingControl); }
+    static size_t totalSize(uint64_t capacity) { return dataOffset() + 2 * capacity; }
+
+    ShmRegion(int fd, size_t size) : fd(fd), size(size) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            this->fd = -1;
+            throw std::runtime_error(std::string("mmap: ") + std::strerror(err));
+        }
+    }
+
+    ShmRingControl* controls() {
+        return reinterpret_cast<ShmRingControl*>(static_cast<char*>(base) + controlOffset());
+    }
+    char* dataStart() { return static_cast<char*>(base) + dataOffset(); }
+
+    int fd;
+    size_t size;
+    void* base = MAP_FAILED;
+};
+
+// Doorbells are plain eventfds; ringing one is a single 8-byte write.
+inline int makeDoorbell() {
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("eventfd: ") + std::strerror(errno));
+    }
+    return fd;
+}
+
+inline void ringDoorbell(int fd) {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+inline void clearDoorbell(int fd) {
+    uint64_t count;
+    ssize_t ignored = ::read(fd, &count, sizeof(count));
+    (void)ignored;
+}
+
+#endif // SHM_RING_HPP
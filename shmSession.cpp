@@ -0,0 +1,216 @@
+#include "shmSession.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+// ============================================================================
+// SHM SESSION - Room traffic over the shared-memory rings
+// ============================================================================
+
+ShmSession::ShmSession(const StreamSocket::executor_type& executor, Room& room, size_t ringBytes)
+    : executor(executor),
+      room(room),
+      region(ShmRegion::create(ringBytes)),
+      toClient(region->serverToClient()),
+      fromClient(region->clientToServer()),
+      bellWatch(executor, makeDoorbell()) {
+    /*
+     * bellWatch owns my doorbell and closes it; the client's bell is a raw
+     * fd because I only ever write() to it. Created last so a failure here
+     * can't leak the first one.
+     */
+    serverBell = bellWatch.native_handle();
+    clientBell = makeDoorbell();
+    memory.buffers.store(static_cast<int64_t>(sizeof(ShmSession) + 2 * region->capacity()),
+                         std::memory_order_relaxed);
+}
+
+ShmSession::~ShmSession() {
+    int64_t abandoned = static_cast<int64_t>(blocked.size());
+    while (MpscNode* node = outboundInbox.pop()) {
+        delete static_cast<OutboundNode*>(node);
+        ++abandoned;
+    }
+    ServerMetrics::get().outboundQueued.add(-abandoned);
+    if (clientBell >= 0) {
+        ::close(clientBell);
+    }
+}
+
+void ShmSession::start() {
+    waitForBell();
+}
+
+void ShmSession::stop() {
+    /*
+     * Runs on my executor (Session::close()). Leaving the Room stops new
+     * deliveries; closing the eventfd completes the pending wait with
+     * operation_aborted, which drops the last self reference it held. The
+     * client notices through its control socket closing, not the ring.
+     */
+    if (stopped) {
+        return;
+    }
+    stopped = true;
+    room.leave(shared_from_this());
+
+    boost::system::error_code ignored;
+    bellWatch.close(ignored);
+}
+
+void ShmSession::deliver(const FramePtr& frame) {
+    OutboundNode* node = new OutboundNode(frame);
+    if (frame->traceId) {
+        node->tracedAt = Tracer::now();
+    }
+    outboundInbox.push(node);
+    ServerMetrics::get().outboundQueued.add(1);
+    memory.queued.fetch_add(queuedFrameBytes, std::memory_order_relaxed);
+    if (!writeActive.exchange(true, std::memory_order_seq_cst)) {
+        // post(): the room mutex is held here - see Session::deliverOnChannel().
+        auto self = shared_from_this();
+        boost::asio::post(executor, [self]() { self->flushOutbound(); });
+    }
+}
+
+void ShmSession::write(Message& msg) {
+    room.deliver(shared_from_this(), makeFrame(msg, Frame::Clock::now()));
+}
+
+void ShmSession::flushOutbound() {
+    if (stopped) {
+        return;  // writeActive stays set - nothing goes out after stop()
+    }
+
+    /*
+     * Copy frames into the ring until it's full or there's nothing left.
+     * A frame that doesn't fit goes back to the front of `blocked` so order
+     * survives; it's retried when the client rings me after draining.
+     */
+    size_t published = 0;
+    size_t publishedBytes = 0;
+    for (;;) {
+        std::unique_ptr<OutboundNode> node;
+        if (!blocked.empty()) {
+            node = std::move(blocked.front());
+            blocked.pop_front();
+        } else if (MpscNode* raw = outboundInbox.pop()) {
+            node.reset(static_cast<OutboundNode*>(raw));
+        } else {
+            break;
+        }
+
+        const Frame& frame = *node->frame;
+        uint64_t traceStart = frame.traceId ? Tracer::now() : 0;
+        if (!toClient.tryWrite(frame.msg)) {
+            blocked.push_front(std::move(node));
+            break;
+        }
+        ++published;
+        publishedBytes += Message::header + frame.msg.getBodyLength();
+        if (frame.timed()) {
+            room.recordFanout(frame, Frame::Clock::now());  // in the ring = written
+        }
+        if (frame.traceId) {
+            Tracer::span("queue wait", frame.traceId, node->tracedAt, traceStart);
+            Tracer::span("write", frame.traceId, traceStart, Tracer::now());
+        }
+    }
+
+    if (published > 0) {
+        ServerMetrics& metrics = ServerMetrics::get();
+        metrics.framesOut.inc(published);
+        metrics.bytesOut.inc(publishedBytes);
+        metrics.outboundQueued.add(-static_cast<int64_t>(published));
+        memory.queued.fetch_sub(published * queuedFrameBytes, std::memory_order_relaxed);
+        if (toClient.consumerNeedsWake()) {
+            ringDoorbell(clientBell);
+        }
+    }
+
+    auto self = shared_from_this();
+    if (!blocked.empty()) {
+        size_t needed = Message::header + blocked.front()->frame->msg.getBodyLength();
+        if (!toClient.armProducerWait(needed)) {
+            boost::asio::post(executor, [self]() { self->flushOutbound(); });
+        }
+        return;  // keep writeActive: onBell() resumes once there's room
+    }
+
+    /*
+     * Same hand-off as Session::async_write(): clear the flag, then look
+     * again in case a producer pushed after my last pop() but saw the flag
+     * still set. Re-enter through post() - pop() can briefly report empty
+     * while a push is half-linked, and that mustn't turn into recursion.
+     */
+    writeActive.store(false, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!outboundInbox.empty() && !writeActive.exchange(true, std::memory_order_seq_cst)) {
+        boost::asio::post(executor, [self]() { self->flushOutbound(); });
+    }
+}
+
+void ShmSession::drainInbound() {
+    /*
+     * Bounded per wake so one chatty local client can't monopolise the
+     * worker; if frames remain, armConsumerWait() fails and waitForBell()
+     * reschedules me behind whatever else is queued.
+     */
+    static const int maxFramesPerWake = 256;
+
+    auto self = shared_from_this();
+    for (int i = 0; i < maxFramesPerWake; ++i) {
+        ShmRing::ReadResult result = fromClient.tryRead(incoming);
+        if (result == ShmRing::ReadResult::Empty) {
+            break;
+        }
+        if (result == ShmRing::ReadResult::Corrupt) {
+            LOG_WARN("Shared-memory client sent a corrupt frame");
+            ServerMetrics::get().protocolErrors.inc();
+            stop();
+            return;
+        }
+        ServerMetrics& metrics = ServerMetrics::get();
+        metrics.framesIn.inc();
+        metrics.bytesIn.inc(Message::header + incoming.getBodyLength());
+        if (!incoming.isControl()) {
+            room.deliver(self, makeFrame(incoming, Frame::Clock::now(), Tracer::sample()));
+        }
+    }
+
+    if (fromClient.producerNeedsWake()) {
+        ringDoorbell(clientBell);
+    }
+}
+
+void ShmSession::waitForBell() {
+    auto self = shared_from_this();
+    if (!fromClient.armConsumerWait()) {
+        boost::asio::post(executor, [self]() { self->onBell(); });
+        return;
+    }
+    bellWatch.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+        [self](boost::system::error_code ec) {
+            if (!ec) {
+                self->onBell();
+            }
+        });
+}
+
+void ShmSession::onBell() {
+    if (stopped) {
+        return;
+    }
+
+    // Clear first: a ring that lands after this re-arms the eventfd.
+    clearDoorbell(serverBell);
+
+    drainInbound();
+    if (stopped) {
+        return;
+    }
+    if (!blocked.empty()) {
+        flushOutbound();
+    }
+    waitForBell();
+}
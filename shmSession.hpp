@@ -0,0 +1,84 @@
+#include "chatRoom.hpp"
+#include "shmRing.hpp"
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#ifndef SHM_SESSION_HPP
+#define SHM_SESSION_HPP
+
+/*
+ * ============================================================================
+ * SHM SESSION - A Room participant whose "socket" is a pair of rings
+ * ============================================================================
+ *
+ * Created by a Session when its Unix-socket client sends "SHM". It owns the
+ * memfd region and both doorbells, and lives on the Session's worker, so
+ * everything below runs on one thread except deliver() (any thread, same
+ * MPSC inbox + writeActive handshake as Session).
+ *
+ *   outbound:  inbox → server→client ring, ring the client's bell if it
+ *              is asleep. Ring full → keep the frame in `blocked`, arm the
+ *              producer wait and let the client's bell-ring wake us.
+ *
+ *   inbound:   our bell → drain the client→server ring into room.deliver(),
+ *              then arm the consumer wait and sleep on the eventfd again.
+ *
+ * One eventfd wakes us for both reasons; every wake re-checks both rings.
+ * ============================================================================
+ */
+
+class ShmSession : public Participant, public std::enable_shared_from_this<ShmSession> {
+public:
+    ShmSession(const StreamSocket::executor_type& executor, Room& room, size_t ringBytes);
+    ~ShmSession();
+
+    void start();
+    void stop();
+
+    using Participant::deliver;
+    void deliver(const FramePtr& frame) override;
+    void write(Message& msg) override;
+
+    // Handed to the client with SCM_RIGHTS; they stay owned by me.
+    int regionFd() const { return region->fileDescriptor(); }
+    int serverBellFd() const { return serverBell; }
+    int clientBellFd() const { return clientBell; }
+    uint64_t capacity() const { return region->capacity(); }
+
+    // Session labels this and points eviction at itself (closing both).
+    MemoryAccount& memoryAccount() { return memory; }
+
+private:
+    struct OutboundNode : MpscNode {
+        explicit OutboundNode(const FramePtr& f) : frame(f) {}
+        FramePtr frame;
+        uint64_t tracedAt = 0;
+    };
+
+    void flushOutbound();
+    void drainInbound();
+    void waitForBell();
+    void onBell();
+
+    StreamSocket::executor_type executor;
+    Room& room;
+    std::unique_ptr<ShmRegion> region;
+    ShmRing toClient;
+    ShmRing fromClient;
+    int serverBell = -1;
+    int clientBell = -1;
+    boost::asio::posix::stream_descriptor bellWatch;
+
+    MpscQueue outboundInbox;
+    std::atomic<bool> writeActive{false};
+    std::deque<std::unique_ptr<OutboundNode>> blocked;
+    Message incoming;
+    bool stopped = false;
+
+    // queued = inbox + blocked frames; buffers = this object + both rings.
+    static const size_t queuedFrameBytes = sizeof(OutboundNode) + frameFootprint;
+    MemoryAccount memory{"shm"};
+};
+
+#endif // SHM_SESSION_HPP
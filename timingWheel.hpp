@@ -0,0 +1,226 @@
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+/*
+ * ============================================================================
+ * TIMING WHEEL - One timer per io thread instead of one per Session
+ * ============================================================================
+ *
+ * Sessions need timeouts (dead peers never send FIN) and heartbeats. The
+ * obvious answer is a steady_timer per Session. With 100k sessions that's
+ * 100k entries in asio's timer heap: every re-arm is O(log n), and every
+ * read would want to push its idle deadline out again.
+ *
+ * A hashed timing wheel makes all of that O(1):
+ *
+ *   slots: [0][1][2][3] ... [1023]      one steady_timer ticks every 100ms
+ *           │   │                        and advances `current` by one slot
+ *           ▼   ▼
+ *          e1  e4 ─ e7                   each slot is an intrusive list
+ *
+ *   schedule(e, delay):  slot = (now + ticks) & mask, link e  → O(1)
+ *   cancel(e):           unlink e via its own prev/next        → O(1)
+ *   tick:                walk ONE slot, fire what's due        → O(due)
+ *
+ * Deadlines further out than one revolution (~102s) just stay in their slot
+ * and get skipped until their tick comes round - no separate overflow wheel.
+ *
+ * Granularity is one tick. That's fine for idle timeouts measured in
+ * seconds; it's not for anything that needs millisecond precision.
+ *
+ * Threading: the wheel belongs to ONE io_context and must only be touched
+ * from that context's thread. It's an asio service, so
+ *   use_service<TimingWheel>(io)
+ * hands every Session on a worker the same per-thread wheel.
+ *
+ * Entries are intrusive and owned by the caller. An entry must be cancelled
+ * (or have fired) before it's destroyed - the Entry destructor does that.
+ * ============================================================================
+ */
+
+class TimingWheel : public boost::asio::execution_context::service {
+public:
+    using Tick = uint64_t;
+
+    static inline boost::asio::execution_context::id id;
+
+    struct Entry {
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry() { unlink(); }
+
+        bool linked() const { return next != nullptr; }
+
+        void unlink() {
+            if (next != nullptr) {
+                prev->next = next;
+                next->prev = prev;
+                prev = next = nullptr;
+            }
+        }
+
+        std::function<void()> callback;
+
+    private:
+        friend class TimingWheel;
+        Entry* prev = nullptr;
+        Entry* next = nullptr;
+        Tick deadline = 0;
+    };
+
+    static constexpr std::chrono::milliseconds defaultTick{100};
+    static constexpr size_t defaultSlots = 1024;
+
+    explicit TimingWheel(boost::asio::execution_context& context)
+        : TimingWheel(context, defaultTick, defaultSlots) {}
+
+    TimingWheel(boost::asio::execution_context& context,
+                std::chrono::milliseconds tick, size_t slotCount)
+        : boost::asio::execution_context::service(context),
+          timer(static_cast<boost::asio::io_context&>(context)),
+          tickLength(tick),
+          slots(roundUpToPowerOfTwo(slotCount)),
+          mask(slots.size() - 1) {
+        for (Entry& sentinel : slots) {
+            sentinel.prev = sentinel.next = &sentinel;
+        }
+    }
+
+    // Ticks elapsed since the wheel started. Cheap "now" for Sessions.
+    Tick now() const { return current; }
+
+    Tick toTicks(std::chrono::milliseconds duration) const {
+        Tick ticks = static_cast<Tick>((duration + tickLength - std::chrono::milliseconds(1)) / tickLength);
+        return ticks == 0 ? 1 : ticks;
+    }
+
+    std::chrono::milliseconds tick() const { return tickLength; }
+
+    // (Re)arm `entry` to fire `ticks` ticks from now.
+    void scheduleIn(Entry& entry, Tick ticks) {
+        scheduleAt(entry, current + (ticks == 0 ? 1 : ticks));
+    }
+
+    void scheduleAt(Entry& entry, Tick deadline) {
+        entry.unlink();
+        if (deadline <= current) {
+            deadline = current + 1;
+        }
+        entry.deadline = deadline;
+        Entry& head = slots[deadline & mask];
+        entry.prev = head.prev;
+        entry.next = &head;
+        head.prev->next = &entry;
+        head.prev = &entry;
+        startTicking();
+    }
+
+    void cancel(Entry& entry) { entry.unlink(); }
+
+    uint64_t firedCount() const { return fired; }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    void shutdown() override {
+        running = false;
+        boost::system::error_code ignored;
+        timer.cancel(ignored);
+        for (Entry& sentinel : slots) {
+            while (sentinel.next != &sentinel) {
+                sentinel.next->unlink();
+            }
+        }
+    }
+
+    void startTicking() {
+        if (running) {
+            return;
+        }
+        running = true;
+        nextTickAt = std::chrono::steady_clock::now() + tickLength;
+        armTimer();
+    }
+
+    void armTimer() {
+        timer.expires_at(nextTickAt);
+        timer.async_wait([this](boost::system::error_code ec) {
+            if (ec || !running) {
+                return;
+            }
+            /*
+             * Catch up if the loop was busy: advance one slot per elapsed
+             * tick so nothing is skipped, then schedule against the original
+             * cadence rather than "now + tick" to avoid drift.
+             */
+            auto wallNow = std::chrono::steady_clock::now();
+            while (nextTickAt <= wallNow) {
+                advance();
+                nextTickAt += tickLength;
+            }
+            armTimer();
+        });
+    }
+
+    void advance() {
+        ++current;
+        Entry& head = slots[current & mask];
+        if (head.next == &head) {
+            return;
+        }
+
+        /*
+         * Splice the slot onto a local list first. Callbacks are free to
+         * schedule or cancel anything - including entries still waiting in
+         * this batch - without invalidating the walk.
+         */
+        Entry pending;
+        pending.prev = head.prev;
+        pending.next = head.next;
+        pending.prev->next = &pending;
+        pending.next->prev = &pending;
+        head.prev = head.next = &head;
+
+        while (pending.next != &pending) {
+            Entry* entry = pending.next;
+            entry->unlink();
+            if (entry->deadline > current) {
+                // Not this revolution - put it back.
+                Entry& slot = slots[entry->deadline & mask];
+                entry->prev = slot.prev;
+                entry->next = &slot;
+                slot.prev->next = entry;
+                slot.prev = entry;
+                continue;
+            }
+            ++fired;
+            if (entry->callback) {
+                entry->callback();
+            }
+        }
+    }
+
+    boost::asio::steady_timer timer;
+    std::chrono::milliseconds tickLength;
+    std::vector<Entry> slots;   // sentinels of circular intrusive lists
+    size_t mask;
+    Tick current = 0;
+    std::chrono::steady_clock::time_point nextTickAt;
+    bool running = false;
+    uint64_t fired = 0;
+};
+
+#endif // TIMING_WHEEL_HPP
@@ -0,0 +1,160 @@
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+
+// ============================================================================
+// TRACE - Sampling, event formatting and the trace file
+// ============================================================================
+
+namespace {
+
+struct TraceState {
+    std::atomic<size_t> sampleEvery{0};
+    std::atomic<uint32_t> nextId{1};
+    std::atomic<int> nextThread{1};
+    uint64_t origin = 0;
+    int pid = 0;
+
+    std::mutex mutex;
+    std::string pending;
+    FILE* file = nullptr;
+};
+
+TraceState& state() {
+    static TraceState traceState;
+    return traceState;
+}
+
+uint64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Small per-thread track number. The first event from a thread also emits
+ * the metadata record that names its track.
+ */
+int threadTrack(std::string& out) {
+    thread_local int track = 0;
+    if (track == 0) {
+        TraceState& s = state();
+        track = s.nextThread.fetch_add(1, std::memory_order_relaxed);
+        char meta[160];
+        std::snprintf(meta, sizeof(meta),
+                      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                      "\"args\":{\"name\":\"thread %d\"}}",
+                      s.pid, track, track);
+        out += meta;
+        out += ",\n";
+    }
+    return track;
+}
+
+void append(const std::string& events) {
+    TraceState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.pending += events;
+}
+
+} // namespace
+
+void Tracer::configure(size_t sampleEvery, const std::string& path) {
+    TraceState& s = state();
+    if (sampleEvery == 0) {
+        return;
+    }
+    s.file = std::fopen(path.c_str(), "w");
+    if (s.file == nullptr) {
+        throw std::runtime_error("cannot open trace file " + path);
+    }
+    std::fputs("[\n", s.file);
+    s.origin = steadyNanos();
+    s.pid = static_cast<int>(::getpid());
+    s.sampleEvery.store(sampleEvery, std::memory_order_relaxed);
+}
+
+uint32_t Tracer::nextSample(uint64_t& countdown) {
+    TraceState& s = state();
+    size_t every = s.sampleEvery.load(std::memory_order_relaxed);
+    if (every == 0) {
+        // Off: park the countdown where it won't come back for centuries.
+        countdown = std::numeric_limits<uint64_t>::max();
+        return 0;
+    }
+    countdown = every;
+    uint32_t id = s.nextId.fetch_add(1, std::memory_order_relaxed);
+    return id != 0 ? id : s.nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Tracer::now() {
+    return steadyNanos();
+}
+
+void Tracer::span(const char* name, uint32_t traceId, uint64_t startNs, uint64_t endNs) {
+    span(name, traceId, startNs, endNs, nullptr, 0);
+}
+
+void Tracer::span(const char* name, uint32_t traceId, uint64_t startNs, uint64_t endNs,
+                  const char* argName, uint64_t argValue) {
+    TraceState& s = state();
+    if (s.file == nullptr) {
+        return;
+    }
+    std::string out;
+    int track = threadTrack(out);
+
+    // Chrome wants microseconds; fractions keep the nanoseconds.
+    double ts = double(int64_t(startNs - s.origin)) / 1000.0;
+    double dur = endNs > startNs ? double(endNs - startNs) / 1000.0 : 0.0;
+    char event[256];
+    if (argName != nullptr) {
+        std::snprintf(event, sizeof(event),
+                      "{\"name\":\"%s\",\"cat\":\"chat\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                      "\"pid\":%d,\"tid\":%d,\"args\":{\"trace\":%u,\"%s\":%llu}}",
+                      name, ts, dur, s.pid, track, traceId, argName, (unsigned long long)argValue);
+    } else {
+        std::snprintf(event, sizeof(event),
+                      "{\"name\":\"%s\",\"cat\":\"chat\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                      "\"pid\":%d,\"tid\":%d,\"args\":{\"trace\":%u}}",
+                      name, ts, dur, s.pid, track, traceId);
+    }
+    out += event;
+    out += ",\n";
+    append(out);
+}
+
+void Tracer::flush() {
+    TraceState& s = state();
+    std::string events;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        events.swap(s.pending);
+    }
+    if (s.file == nullptr || events.empty()) {
+        return;
+    }
+    std::fwrite(events.data(), 1, events.size(), s.file);
+    std::fflush(s.file);
+}
+
+void Tracer::stop() {
+    TraceState& s = state();
+    s.sampleEvery.store(0, std::memory_order_relaxed);
+    flush();
+    if (s.file != nullptr) {
+        /*
+         * Every event ends in ",\n"; a final metadata record closes the
+         * array cleanly. (The viewers also accept a file cut off mid-array,
+         * so a crash still leaves something readable.)
+         */
+        std::fprintf(s.file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                             "\"args\":{\"name\":\"chatApp\"}}\n]\n", s.pid);
+        std::fclose(s.file);
+        s.file = nullptr;
+    }
+}
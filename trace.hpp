@@ -0,0 +1,73 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+/*
+ * ============================================================================
+ * TRACE - Following one message through the server
+ * ============================================================================
+ *
+ * The latency histograms say p99.9 is 200ms. They can't say where those
+ * 200ms went: waiting for the room lock, sitting in a slow reader's queue,
+ * or stuck in a write. For that I want the life of one message, stage by
+ * stage, on a timeline.
+ *
+ * 1 in N inbound messages gets a trace id (--trace-sample N). The id rides
+ * on the Frame, and each stage that sees a traced frame records a span:
+ *
+ *   read body      header arrived → body complete. A message's trace
+ *                  starts here: before its header, the wait is just
+ *                  the client being quiet.
+ *   Room::deliver  the lock + fan-out loop, args: recipients
+ *   queue wait     per recipient: pushed on its inbox → its batch starts
+ *   write          per recipient: batch starts → write completion
+ *                  (for a shared-memory recipient: published to the ring)
+ *
+ * Output is Chrome trace-event JSON (--trace-file), openable in Perfetto or
+ * chrome://tracing. One track per thread; search for args.trace to line up
+ * one message's spans across threads.
+ *
+ * Cost: deciding is a thread-local countdown - one predictable branch per
+ * message when nothing is sampled, and every instrumentation point checks
+ * frame.traceId (one more branch) before doing anything else. Sampled spans
+ * are formatted on the calling thread and appended to a buffer under a
+ * mutex, which is fine at 1-in-N; flush() writes the buffer out from the
+ * housekeeping timer, so io threads never touch the file.
+ * ============================================================================
+ */
+
+class Tracer {
+public:
+    // sampleEvery == 0 leaves tracing off. Throws if the file can't be opened.
+    static void configure(size_t sampleEvery, const std::string& path);
+
+    // 0 = don't trace this one, otherwise a fresh trace id.
+    static uint32_t sample() {
+        thread_local uint64_t countdown = 1;
+        if (--countdown != 0) {
+            return 0;
+        }
+        return nextSample(countdown);
+    }
+
+    // Trace clock: steady_clock nanoseconds.
+    static uint64_t now();
+
+    static void span(const char* name, uint32_t traceId, uint64_t startNs, uint64_t endNs);
+    static void span(const char* name, uint32_t traceId, uint64_t startNs, uint64_t endNs,
+                     const char* argName, uint64_t argValue);
+
+    // Append buffered events to the file. Housekeeping thread only.
+    static void flush();
+
+    // Flush and close the JSON array.
+    static void stop();
+
+private:
+    static uint32_t nextSample(uint64_t& countdown);
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,200 @@
+#include "watchdog.hpp"
+#include "log.hpp"
+#include "metrics.hpp"
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <execinfo.h>
+#include <unistd.h>
+
+// ============================================================================
+// WATCHDOG - Heartbeats, stack samples and utilization
+// ============================================================================
+
+namespace {
+
+uint64_t monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * One stack sample at a time - only the watchdog thread asks for them, and
+ * it waits for each before moving on.
+ */
+const int maxFrames = 48;
+void* sampledFrames[maxFrames];
+std::atomic<int> sampledDepth{-1};
+
+int sampleSignal() {
+    return SIGRTMIN + 4;
+}
+
+void onSampleSignal(int) {
+    sampledDepth.store(backtrace(sampledFrames, maxFrames), std::memory_order_release);
+}
+
+void installSampleHandler() {
+    /*
+     * backtrace() loads libgcc on first use, which allocates - not
+     * something to do inside a signal handler. Get it done here.
+     */
+    void* warmUp[1];
+    backtrace(warmUp, 1);
+
+    struct sigaction action {};
+    action.sa_handler = onSampleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(sampleSignal(), &action, nullptr);
+}
+
+} // namespace
+
+Watchdog::Watchdog(std::chrono::milliseconds budget) : budget(budget) {}
+
+Watchdog::~Watchdog() {
+    stop();
+}
+
+void Watchdog::watch(const std::string& name, boost::asio::io_context& io) {
+    auto loop = std::make_unique<Loop>();
+    loop->name = name;
+    loop->io = &io;
+    loops.push_back(std::move(loop));
+}
+
+void Watchdog::start() {
+    /*
+     * Registered grouped by metric (all lags, then all utilizations, then
+     * all stall counters) - the registry prints HELP/TYPE per run of names.
+     */
+    MetricsRegistry& registry = MetricsRegistry::global();
+    for (auto& loop : loops) {
+        loop->lag = &registry.latency("chat_loop_lag_seconds",
+                                      "Heartbeat posted to an io_context until it ran.",
+                                      "loop=\"" + loop->name + "\"");
+    }
+    for (auto& loop : loops) {
+        Loop* watched = loop.get();
+        registry.callback("chat_loop_utilization", "Share of wall time the loop thread was on CPU, last second.",
+                          "gauge", [watched]() { return watched->utilization.load(std::memory_order_relaxed); },
+                          "loop=\"" + loop->name + "\"");
+    }
+    for (auto& loop : loops) {
+        loop->stalls = &registry.counter("chat_loop_stalls_total",
+                                         "Heartbeats that waited longer than --stall-budget.",
+                                         "loop=\"" + loop->name + "\"");
+    }
+
+    installSampleHandler();
+    running = true;
+    thread = std::thread([this]() { run(); });
+}
+
+void Watchdog::stop() {
+    if (running.exchange(false) && thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Watchdog::run() {
+    // Fine enough to catch a stall near the budget, cheap enough to not notice.
+    auto tick = std::min<std::chrono::milliseconds>(std::chrono::milliseconds(10), budget / 4);
+    if (tick.count() == 0) {
+        tick = std::chrono::milliseconds(1);
+    }
+    uint64_t nextUtilization = monotonicNanos() + 1000000000ull;
+
+    while (running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(tick);
+        uint64_t now = monotonicNanos();
+        for (auto& loop : loops) {
+            check(*loop, now);
+        }
+        if (now >= nextUtilization) {
+            for (auto& loop : loops) {
+                sampleUtilization(*loop, now);
+            }
+            nextUtilization = now + 1000000000ull;
+        }
+    }
+}
+
+void Watchdog::check(Loop& loop, uint64_t now) {
+    uint64_t posted = loop.postedAt.load(std::memory_order_acquire);
+    if (posted == 0) {
+        if (loop.stalled) {
+            loop.stalled = false;
+            LOG_WARN("Event loop {} is turning again", loop.name);
+        }
+        loop.postedAt.store(now, std::memory_order_release);
+        Loop* watched = &loop;
+        boost::asio::post(*loop.io, [watched]() {
+            if (!watched->threadKnown.load(std::memory_order_relaxed)) {
+                watched->thread = pthread_self();
+                watched->threadKnown.store(true, std::memory_order_release);
+            }
+            uint64_t postedAt = watched->postedAt.load(std::memory_order_acquire);
+            watched->lag->record(monotonicNanos() - postedAt);
+            watched->postedAt.store(0, std::memory_order_release);
+        });
+        return;
+    }
+
+    uint64_t waited = now - posted;
+    if (!loop.stalled && waited > uint64_t(std::chrono::nanoseconds(budget).count())) {
+        loop.stalled = true;
+        loop.stalls->inc();
+        sampleStack(loop, waited);
+    }
+}
+
+void Watchdog::sampleStack(Loop& loop, uint64_t stalledFor) {
+    LOG_WARN("Event loop {} stalled: heartbeat pending for {}ms (budget {}ms)", loop.name,
+             stalledFor / 1000000, budget.count());
+    if (!loop.threadKnown.load(std::memory_order_acquire)) {
+        return;  // never ran a heartbeat yet - nothing to signal
+    }
+
+    sampledDepth.store(-1, std::memory_order_relaxed);
+    if (pthread_kill(loop.thread, sampleSignal()) != 0) {
+        return;
+    }
+    // The handler runs as soon as the thread is scheduled; don't wait forever.
+    for (int i = 0; i < 100 && sampledDepth.load(std::memory_order_acquire) < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int depth = sampledDepth.load(std::memory_order_acquire);
+    if (depth <= 0) {
+        return;
+    }
+    std::fprintf(stderr, "---- stack of stalled loop %s ----\n", loop.name.c_str());
+    std::fflush(stderr);
+    backtrace_symbols_fd(sampledFrames, depth, STDERR_FILENO);
+    std::fprintf(stderr, "----\n");
+    std::fflush(stderr);
+}
+
+void Watchdog::sampleUtilization(Loop& loop, uint64_t now) {
+    if (!loop.threadKnown.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (!loop.cpuClockValid) {
+        loop.cpuClockValid = pthread_getcpuclockid(loop.thread, &loop.cpuClock) == 0;
+        if (!loop.cpuClockValid) {
+            return;
+        }
+    }
+    timespec cpu{};
+    if (clock_gettime(loop.cpuClock, &cpu) != 0) {
+        return;
+    }
+    uint64_t cpuNanos = uint64_t(cpu.tv_sec) * 1000000000ull + uint64_t(cpu.tv_nsec);
+    if (loop.lastWall != 0 && now > loop.lastWall) {
+        double share = double(cpuNanos - loop.lastCpu) / double(now - loop.lastWall);
+        loop.utilization.store(share > 1.0 ? 1.0 : share, std::memory_order_relaxed);
+    }
+    loop.lastCpu = cpuNanos;
+    loop.lastWall = now;
+}
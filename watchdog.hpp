@@ -0,0 +1,93 @@
+#include <utility>  // must precede asio: boost 1.74 awaitable.hpp uses std::exchange
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+#ifndef WATCHDOG_HPP
+#define WATCHDOG_HPP
+
+class Counter;
+class LatencyHistogram;
+
+/*
+ * ============================================================================
+ * WATCHDOG - Noticing when an event loop stops turning
+ * ============================================================================
+ *
+ * Every Session on a worker shares that worker's thread. One slow handler
+ * - a 10k-member fan-out, a blocking write to a full stdout pipe - and
+ * every client on the loop freezes with it, while all the per-message
+ * metrics look fine because nothing is being measured during the freeze.
+ *
+ * So a separate thread watches from outside. Every tick it posts a
+ * heartbeat into each watched io_context and remembers when:
+ *
+ *   lag          post → run, recorded as a LatencyHistogram. A healthy
+ *                loop runs it within microseconds.
+ *   stall        a heartbeat still pending after --stall-budget: whatever
+ *                is running now (or the queue in front of it) is over
+ *                budget. The watchdog signals that loop's thread, whose
+ *                handler takes a backtrace() of itself, and the stack goes
+ *                to stderr - the watchdog isn't an io thread, so it can
+ *                afford a direct write. One sample per stall.
+ *   utilization  the loop thread's CPU time / wall time, once a second.
+ *                asio sleeps in epoll_wait when idle, so CPU time is busy
+ *                time.
+ *
+ * Exported as chat_loop_lag_seconds, chat_loop_utilization and
+ * chat_loop_stalls_total, labelled loop="accept" / "worker-N".
+ *
+ * The sample signal is SIGRTMIN+4 with SA_RESTART; asio already retries
+ * the odd EINTR.
+ * ============================================================================
+ */
+
+class Watchdog {
+public:
+    explicit Watchdog(std::chrono::milliseconds budget);
+    ~Watchdog();
+
+    // Call for every loop before start().
+    void watch(const std::string& name, boost::asio::io_context& io);
+
+    void start();
+    // Before the watched loops stop - a stopped loop looks exactly like a stall.
+    void stop();
+
+private:
+    struct Loop {
+        std::string name;
+        boost::asio::io_context* io;
+        LatencyHistogram* lag = nullptr;
+        Counter* stalls = nullptr;
+
+        std::atomic<uint64_t> postedAt{0};  // 0 = no heartbeat in flight
+        std::atomic<bool> threadKnown{false};
+        pthread_t thread{};
+        std::atomic<double> utilization{0.0};
+
+        // Watchdog thread only.
+        bool stalled = false;
+        bool cpuClockValid = false;
+        clockid_t cpuClock{};
+        uint64_t lastCpu = 0;
+        uint64_t lastWall = 0;
+    };
+
+    void run();
+    void check(Loop& loop, uint64_t now);
+    void sampleUtilization(Loop& loop, uint64_t now);
+    void sampleStack(Loop& loop, uint64_t stalledFor);
+
+    std::chrono::milliseconds budget;
+    std::vector<std::unique_ptr<Loop>> loops;
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+#endif // WATCHDOG_HPP